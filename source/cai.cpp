@@ -1,7 +1,10 @@
 #include "cai.h"
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -11,13 +14,23 @@ void Cai::printInstructions() {
 		<< "\texit: terminates cai" << '\n'
 		<< "\tplay: starts a player vs player game" << '\n'
 		<< "\tperft [N]: starts a perft test with N depth" << '\n'
+		<< "\tsearchstats [json(opt)]: searches a position with the min max ai and prints the search statistics" << '\n'
+		<< "\tanalyze [file] [lines(opt)]: prints the best [lines] lines of every FEN in [file] with the min max ai" << '\n'
+		<< "\tmate [N(opt)]: looks for a forced mate in at most N moves, any length if N is not given" << '\n'
 		<< "\tthreads [N]: set the number of threads to [N]" << '\n'
+		<< "\thash [MB]: set the size of the transposition table of the min max ai to [MB]" << '\n'
+		<< "\tponder [on/off]: lets the min max ai search on the time of its opponent" << '\n'
+		<< "\tmovetime [ms]: time the min max ai has for a move in a game, 0 searches to the full depth" << '\n'
+		<< "\tquantized [on/off]: lets the nn ai play with the int8 copy of its analyzer" << '\n'
 		<< "\tcreate [name] [size(opt)]: creates a new population" << '\n'
 		<< "\tload [name]: loads ai population" << '\n'
 		<< "\tsave: saves the current population" << '\n'
 		<< "\tinfo: Shows current population info" << '\n'
-		<< "\tplayai [color(opt)]: plays the current ai" << '\n'
-		<< "\ttrain [sessions] [times(opt)]: runs [sessions] training sessions [times] times" << '\n';
+		<< "\tplayai [color(opt)] [ai(opt)] [--network file(opt)]: plays the best ai of the population, or the ai given by [ai]: nn, minmax, mcts, --network plays the nn ai with an analyzer saved by fit" << '\n'
+		<< "\tquantize [name]: exports the analyzer of the best ai with int8 weights and compares it with the float one" << '\n'
+		<< "\ttrain [sessions] [times(opt)]: runs [sessions] training sessions [times] times" << '\n'
+		<< "\tgenerate [dataset] [games] [depth(opt)]: plays [games] min max games and writes their positions to [dataset]" << '\n'
+		<< "\tfit [dataset] [name] [epochs(opt)]: fits the analyzer in [name] to the positions of [dataset], a new one if there is none" << '\n';
 }
 
 void Cai::playGame() {
@@ -40,6 +53,88 @@ void Cai::runPerft(int depth) {
 	}
 }
 
+void Cai::runSearchStats(bool json) {
+	// Only the statistics go to stdout in json mode so they can be parsed
+	std::ostream& messages = json ? std::cerr : std::cout;
+	std::string fen;
+	messages << "Give the FEN for the position(empty for default): ";
+	std::getline(std::cin, fen);
+	ChessBoard board = fen.empty() ? ChessBoard() : ChessBoard(fen);
+	MinMaxAiPlayer player(board.getNextPlayerColor(), !json);
+	player.setMemoSize(m_memoSizeMB);
+	BoardMove move;
+	if (player.getMove(board, &move) != MoveResult::MOVE_OK) {
+		messages << "No moves available in this position" << '\n';
+		return;
+	}
+	if (json) {
+		player.getSearchStats().printJson(std::cout);
+		return;
+	}
+	std::cout << "Best move: ";
+	board.printMoveOnBoard(move);
+}
+
+void Cai::analyzePositions(const std::string& fileName, int lines) {
+	std::ifstream file(fileName);
+	if (!file) {
+		std::cout << "Could not open " << fileName << '\n';
+		return;
+	}
+
+	// One player for each side to move is kept for the whole file, its tables are emptied between the positions
+	std::unique_ptr<MinMaxAiPlayer<>> players[2];
+	std::string fen;
+	while (std::getline(file, fen)) {
+		if (fen.empty()) {
+			continue;
+		}
+		ChessBoard board(fen);
+		std::unique_ptr<MinMaxAiPlayer<>>& player = players[board.getNextPlayerColor() == WHITE ? 0 : 1];
+		if (!player) {
+			player = std::make_unique<MinMaxAiPlayer<>>(board.getNextPlayerColor(), false);
+			player->setMemoSize(m_memoSizeMB);
+			player->setMultiPV(std::max(1, lines));
+		}
+		else {
+			player->clearTables();
+		}
+		std::cout << fen << '\n';
+		for (const SearchLine& line : player->analyze(board)) {
+			std::cout << '\t' << line.evaluation << " ->";
+			for (const BoardMove move : line.moves) {
+				std::cout << ' ' << move.toString();
+			}
+			std::cout << '\n';
+		}
+	}
+}
+
+void Cai::solveMate(int moves) {
+	std::string fen;
+	std::cout << "Give the FEN for the position(empty for default): ";
+	std::getline(std::cin, fen);
+	ChessBoard board = fen.empty() ? ChessBoard() : ChessBoard(fen);
+	MateSolver solver;
+	const MateResult result = solver.solve(board, std::max(0, moves), DEFAULT_MATE_SOLVER_NODES);
+	switch (result.status) {
+	case MateStatus::MATE:
+		std::cout << "Mate in " << result.mateInMoves << ":";
+		for (const BoardMove move : result.moves) {
+			std::cout << ' ' << move.toString();
+		}
+		std::cout << '\n';
+		break;
+	case MateStatus::NO_MATE:
+		std::cout << "No forced mate" << (moves > 0 ? " in " + std::to_string(moves) + " moves" : "") << '\n';
+		break;
+	default:
+		std::cout << "Could not decide within the node limit" << '\n';
+		break;
+	}
+	std::cout << "Nodes: " << result.nodes << '\n';
+}
+
 void Cai::createPopulation(const std::string& name) {
 	createPopulation(name, 0);
 }
@@ -106,24 +201,75 @@ void Cai::setThreads(int threads) {
 	m_threads = threads;
 }
 
-void Cai::playGameVSAI(Color playerColor) {
+std::unique_ptr<Player> Cai::createAIPlayer(Color color, const std::string& ai, const std::string& networkFile) {
+	if (!networkFile.empty() && ai != "nn") {
+		std::cout << "Only the nn ai plays with a network file" << '\n';
+		return nullptr;
+	}
+	if (ai == "minmax") {
+		auto player = std::make_unique<MinMaxAiPlayer<>>(color, false);
+		player->setMemoSize(m_memoSizeMB);
+		player->setMoveTime(std::chrono::milliseconds(m_moveTimeMs));
+		player->setPondering(m_ponder);
+		return player;
+	}
+	if (ai == "mcts") {
+		return std::make_unique<MCTSPlayer<>>(color, false, m_threads);
+	}
+	if (ai != "nn") {
+		std::cout << "Unknown ai " << ai << ", run 'playai [color(opt)] [ai(opt)]' with nn, minmax or mcts" << '\n';
+		return nullptr;
+	}
+	if (!networkFile.empty()) {
+		DenseNetwork analyzer;
+		if (!analyzer.loadFromDisk(networkFile)) {
+			std::cout << "Could not load " << networkFile << '\n';
+			return nullptr;
+		}
+		if (analyzer.getInputSize() != BOARD_SIZE * BOARD_SIZE || analyzer.getOutputSize() != 1) {
+			std::cout << networkFile << " is not an analyzer, it has to take a board and give one evaluation" << '\n';
+			return nullptr;
+		}
+		if (m_quantized) {
+			return std::make_unique<NNAIPlayer>(color, std::make_shared<const QuantizedNetwork>(analyzer));
+		}
+		return std::make_unique<NNAIPlayer>(color, std::make_shared<const CompiledAnalyzer>(analyzer, nullptr));
+	}
 	if (!m_population) {
 		std::cout << "No population loaded, cannot play game..." << '\n';
+		return nullptr;
+	}
+	if (m_quantized) {
+		const std::optional<DenseNetwork> analyzer = copyAnalyzer(m_population->getBestNNAiConstRef());
+		if (!analyzer) {
+			std::cout << "The analyzer cannot be copied from nnpp, so it cannot be quantized" << '\n';
+			return nullptr;
+		}
+		return std::make_unique<NNAIPlayer>(color, std::make_shared<const QuantizedNetwork>(*analyzer));
+	}
+	auto player = std::make_unique<NNAIPlayer>(color, &m_population->getBestNNAiConstRef());
+	if (!player->usesCompiledAnalyzer()) {
+		std::cout << "The copy of the analyzer does not match nnpp, the player evaluates with feedAt" << '\n';
+	}
+	return player;
+}
+
+void Cai::playGameVSAI(Color playerColor, const std::string& ai, const std::string& networkFile) {
+	Color aiColor = playerColor == Color::WHITE ? Color::BLACK : Color::WHITE;
+	std::unique_ptr<Player> aip = createAIPlayer(aiColor, ai, networkFile);
+	if (!aip) {
 		return;
 	}
-	nnpp::NeuronBuffer<float> neuronBuffer = nnpp::allocNeuronBuffer<float>();
 	ChessBoard b;
-	Color aiColor = playerColor == Color::WHITE ? Color::BLACK : Color::WHITE;
 	HumanPlayer human(playerColor);
-	NNAIPlayer aip(aiColor, &m_population->getBestNNAiConstRef(), &neuronBuffer);
 	Player* white;
 	Player* black;
 	if (playerColor == Color::WHITE) {
 		white = &human;
-		black = &aip;
+		black = aip.get();
 	}
 	else {
-		white = &aip;
+		white = aip.get();
 		black = &human;
 	}
 	Game g(b, white, black, 0, true);
@@ -164,6 +310,92 @@ void Cai::printLayers() const {
 	analyzer.printLayerSizes();
 }
 
+void Cai::quantizeAnalyzer(const std::string& name) const {
+	if (!m_population) {
+		std::cout << "No population loaded, cannot quantize..." << '\n';
+		return;
+	}
+	const std::optional<DenseNetwork> copy = copyAnalyzer(m_population->getBestNNAiConstRef());
+	if (!copy) {
+		std::cout << "The analyzer cannot be copied from nnpp, so it cannot be quantized" << '\n';
+		return;
+	}
+	const DenseNetwork& analyzer = *copy;
+	const QuantizedNetwork quantizedAnalyzer(analyzer);
+	if (!quantizedAnalyzer.saveToDisk(name + QUANTIZED_EXT)) {
+		std::cout << "Could not save " << name + QUANTIZED_EXT << '\n';
+		return;
+	}
+
+	// The positions of random games, the network is checked on the kind of boards it sees in play
+	RandomGenerator rgen;
+	std::vector<float> inputs;
+	inputs.reserve(static_cast<size_t>(QUANTIZATION_CHECK_POSITIONS) * analyzer.getInputSize());
+	ChessBoard board;
+	for (uint i = 0; i < QUANTIZATION_CHECK_POSITIONS; ++i) {
+		MovesVector moves;
+		board.getNextPlayerMoves(moves);
+		if (moves.empty() || board.isDraw()) {
+			board = ChessBoard();
+			board.getNextPlayerMoves(moves);
+		}
+		board.playMove(moves[rgen.getUint32() % moves.size()]);
+		const nnpp::NNPPStackVector<float> values = board.asFloats();
+		inputs.insert(inputs.end(), values.begin(), values.end());
+	}
+	const QuantizationError error = measureQuantizationError(analyzer, quantizedAnalyzer, inputs.data(), QUANTIZATION_CHECK_POSITIONS);
+
+	std::cout << "Saved " << name + QUANTIZED_EXT << ", kernel: " << quantized::getKernelName() << '\n'
+		<< "Weights: " << quantizedAnalyzer.getWeightBytes() << " bytes, float: " << analyzer.getNumOfWeights() * sizeof(float) << " bytes" << '\n'
+		<< "Max error: " << error.maxError << ", mean error: " << error.meanError << ", max output: " << error.maxOutput << '\n';
+}
+
+void Cai::fitAnalyzer(const std::string& datasetFile, const std::string& name, int epochs) const {
+	PositionReader reader;
+	if (!reader.open(datasetFile)) {
+		std::cout << "Could not open dataset " << datasetFile << '\n';
+		return;
+	}
+	DenseNetwork analyzer;
+	if (!analyzer.loadFromDisk(name + DENSE_EXT)) {
+		RandomGenerator rgen;
+		analyzer = DenseNetwork(ANALYZER_LAYOUT, NNPP_HIDDEN_ACTIVATION);
+		analyzer.initHeUniform(rgen);
+		std::cout << "Created a new analyzer for " << name + DENSE_EXT << '\n';
+	}
+
+	FitSettings settings;
+	settings.threads = std::max(1, m_threads);
+	SupervisedTrainer trainer(&analyzer, settings);
+	epochs = std::max(1, epochs);
+	for (int epoch = 0; epoch < epochs; ++epoch) {
+		reader.rewind();
+		const FitReport report = trainer.fitEpoch(reader);
+		if (!analyzer.saveToDisk(name + DENSE_EXT)) {
+			std::cout << "Could not save " << name + DENSE_EXT << '\n';
+			return;
+		}
+		std::cout << "Epoch " << (epoch + 1) << " out of " << epochs << ", positions: " << report.positions
+			<< ", loss: " << report.meanLoss << '\n';
+	}
+}
+
+void Cai::generateDataset(const std::string& datasetFile, int games, int depth) const {
+	SelfPlaySettings settings;
+	settings.games = std::max(1, games);
+	settings.threads = std::max(1, m_threads);
+	if (depth > 0) {
+		settings.searchDepth = depth;
+	}
+	settings.seed = RandomGenerator().getUint32();
+	const SelfPlayReport report = generateSelfPlayDataset(datasetFile, settings);
+	if (!report.written) {
+		std::cout << "Could not write " << datasetFile << '\n';
+		return;
+	}
+	std::cout << "Games: " << report.games << ", positions: " << report.positions << '\n';
+}
+
 void Cai::processCommand(const std::string& command, const std::vector<std::string>& arguments) {
 	if (command == "help") {
 		printInstructions();
@@ -186,6 +418,35 @@ void Cai::processCommand(const std::string& command, const std::vector<std::stri
 		}
 		runPerft(atoi(arguments[0].c_str()));
 	}
+	else if (command == "searchstats") {
+		runSearchStats(!arguments.empty() && arguments[0] == "json");
+	}
+	else if (command == "analyze") {
+		if (arguments.empty() || arguments[0].empty()) {
+			std::cout << "No argument for the positions file, run 'analyze [file] [lines(opt)]'" << '\n';
+			return;
+		}
+		if (arguments.size() >= 2) {
+			if (arguments[1].empty() || !isdigit(arguments[1][0])) {
+				std::cout << "Bad argument for the number of lines" << '\n';
+				return;
+			}
+			analyzePositions(arguments[0], atoi(arguments[1].c_str()));
+			return;
+		}
+		analyzePositions(arguments[0], 1);
+	}
+	else if (command == "mate") {
+		if (!arguments.empty() && !arguments[0].empty()) {
+			if (!isdigit(arguments[0][0])) {
+				std::cout << "Bad argument for the number of moves" << '\n';
+				return;
+			}
+			solveMate(atoi(arguments[0].c_str()));
+			return;
+		}
+		solveMate(0);
+	}
 	else if (command == "create") {
 		if (arguments.empty() || arguments[0].empty()) {
 			std::cout << "No arguments for population name, run 'create [name] [size(opt)]'" << '\n';
@@ -230,18 +491,61 @@ void Cai::processCommand(const std::string& command, const std::vector<std::stri
 		trainPopulation(atoi(arguments[0].c_str()));
 	}
 	else if(command == "playai") {
-		if (arguments.size() >= 1 && !arguments[0].empty()) {
-			if (arguments[0] == "white") {
-				playGameVSAI(Color::WHITE);
+		// --network [file] can come anywhere after the command, the rest of the arguments are the color and the ai
+		std::vector<std::string> positional;
+		std::string networkFile;
+		for (size_t i = 0; i < arguments.size(); ++i) {
+			if (arguments[i] != "--network") {
+				positional.push_back(arguments[i]);
+				continue;
+			}
+			if (i + 1 >= arguments.size() || arguments[i + 1].empty()) {
+				std::cout << "No argument for the network file, run 'playai [color(opt)] [ai(opt)] [--network file(opt)]'" << '\n';
 				return;
 			}
-			else if (arguments[0] == "black") {
-				playGameVSAI(Color::BLACK);
+			networkFile = arguments[++i];
+		}
+		const std::string ai = positional.size() >= 2 && !positional[1].empty() ? positional[1] : "nn";
+		if (positional.size() >= 1 && !positional[0].empty()) {
+			if (positional[0] == "white") {
+				playGameVSAI(Color::WHITE, ai, networkFile);
+				return;
+			}
+			else if (positional[0] == "black") {
+				playGameVSAI(Color::BLACK, ai, networkFile);
 				return;
 			}
 			std::cout << "Bad argument for color, playing with white" << '\n';
 		}
-		playGameVSAI(Color::WHITE);
+		playGameVSAI(Color::WHITE, ai, networkFile);
+	}
+	else if (command == "hash") {
+		if (arguments.empty() || arguments[0].empty() || !isdigit(arguments[0][0]) || atoi(arguments[0].c_str()) <= 0) {
+			std::cout << "Bad arguments for the table size, run 'hash [MB]'" << '\n';
+			return;
+		}
+		m_memoSizeMB = atoi(arguments[0].c_str());
+	}
+	else if (command == "ponder") {
+		if (arguments.empty() || (arguments[0] != "on" && arguments[0] != "off")) {
+			std::cout << "Bad arguments for ponder, run 'ponder [on/off]'" << '\n';
+			return;
+		}
+		m_ponder = arguments[0] == "on";
+	}
+	else if (command == "quantized") {
+		if (arguments.empty() || (arguments[0] != "on" && arguments[0] != "off")) {
+			std::cout << "Bad arguments for quantized, run 'quantized [on/off]'" << '\n';
+			return;
+		}
+		m_quantized = arguments[0] == "on";
+	}
+	else if (command == "movetime") {
+		if (arguments.empty() || arguments[0].empty() || !isdigit(arguments[0][0])) {
+			std::cout << "Bad arguments for the move time, run 'movetime [ms]'" << '\n';
+			return;
+		}
+		m_moveTimeMs = atoi(arguments[0].c_str());
 	}
 	else if (command == "threads") {
 		if (arguments.empty() || arguments[0].empty() || !isdigit(arguments[0][0])) {
@@ -250,6 +554,43 @@ void Cai::processCommand(const std::string& command, const std::vector<std::stri
 		}
 		setThreads(atoi(arguments[0].c_str()));
 	}
+	else if (command == "quantize") {
+		if (arguments.empty() || arguments[0].empty()) {
+			std::cout << "No argument for the file name, run 'quantize [name]'" << '\n';
+			return;
+		}
+		quantizeAnalyzer(arguments[0]);
+	}
+	else if (command == "generate") {
+		if (arguments.size() < 2 || arguments[0].empty() || arguments[1].empty() || !isdigit(arguments[1][0])) {
+			std::cout << "Bad arguments for generate, run 'generate [dataset] [games] [depth(opt)]'" << '\n';
+			return;
+		}
+		if (arguments.size() >= 3) {
+			if (arguments[2].empty() || !isdigit(arguments[2][0])) {
+				std::cout << "Bad argument for the search depth" << '\n';
+				return;
+			}
+			generateDataset(arguments[0], atoi(arguments[1].c_str()), atoi(arguments[2].c_str()));
+			return;
+		}
+		generateDataset(arguments[0], atoi(arguments[1].c_str()), 0);
+	}
+	else if (command == "fit") {
+		if (arguments.size() < 2 || arguments[0].empty() || arguments[1].empty()) {
+			std::cout << "Bad arguments for fit, run 'fit [dataset] [name] [epochs(opt)]'" << '\n';
+			return;
+		}
+		if (arguments.size() >= 3) {
+			if (arguments[2].empty() || !isdigit(arguments[2][0])) {
+				std::cout << "Bad argument for the number of epochs" << '\n';
+				return;
+			}
+			fitAnalyzer(arguments[0], arguments[1], atoi(arguments[2].c_str()));
+			return;
+		}
+		fitAnalyzer(arguments[0], arguments[1], 1);
+	}
 	else if(command == "printlayers") {
 		printLayers();
 	}
@@ -4,6 +4,11 @@
 #include "neural-net-ai/nnai-trainer.h"
 #include "neural-net-ai/nnai-player.h"
 #include "neural-net-ai/cai-population.h"
+#include "neural-net-ai/quantized-network.h"
+#include "neural-net-ai/supervised-trainer.h"
+#include "min-max-ai/min-max-ai-player.h"
+#include "min-max-ai/self-play-generator.h"
+#include "mcts-ai/mcts-player.h"
 #include "tools/util.h"
 #include "tools/testing.h"
 
@@ -13,15 +18,25 @@
 static const uint64_t VERSION = 10;
 static const uint DEFAULT_POPULATION = 100;
 static const std::string CAI_EXT = ".cai";
+static const std::string QUANTIZED_EXT = ".caiq";
+static const uint QUANTIZATION_CHECK_POSITIONS = 512;
+static const std::string DENSE_EXT = ".cain";
 
 class Cai {
 private:
 	std::unique_ptr<CAIPopulation> m_population;
 	int m_threads;
+	size_t m_memoSizeMB;
+	bool m_ponder;
+	int m_moveTimeMs;
+	bool m_quantized;
 
 	void printInstructions();
 	void playGame();
 	void runPerft(int depth);
+	void runSearchStats(bool json);
+	void analyzePositions(const std::string& fileName, int lines);
+	void solveMate(int moves);
 	std::string parseCommand(std::vector<std::string>* arguments);
 	void processCommand(const std::string& command, const std::vector<std::string>& arguments);
 	void createPopulation(const std::string& name, int population);
@@ -31,12 +46,16 @@ private:
 	void printInfo();
 	void trainPopulation(int sessions);
 	void trainPopulation(int sesssions, int times);
-	void playGameVSAI(Color playerColor);
+	void playGameVSAI(Color playerColor, const std::string& ai, const std::string& networkFile);
+	std::unique_ptr<Player> createAIPlayer(Color color, const std::string& ai, const std::string& networkFile);
 	void setThreads(int threads);
 	void printLayers() const;
+	void quantizeAnalyzer(const std::string& name) const;
+	void fitAnalyzer(const std::string& datasetFile, const std::string& name, int epochs) const;
+	void generateDataset(const std::string& datasetFile, int games, int depth) const;
 
 public:
-	Cai() : m_threads(4), m_population(nullptr) { }
+	Cai() : m_population(nullptr), m_threads(4), m_memoSizeMB(DEFAULT_TRANSPOSITION_TABLE_MB), m_ponder(false), m_moveTimeMs(0), m_quantized(false) { }
 
 	void start();
 };
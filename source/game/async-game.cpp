@@ -0,0 +1,36 @@
+#include "game/async-game.h"
+
+Task<MoveResult> SyncPlayer::getMove(const ChessBoard& board, BoardMove* move) {
+	co_return m_player->getMove(board, move);
+}
+
+Task<GameResult> AsyncGame::play() {
+	BoardMove m;
+
+	while (m_maxMoves <= 0 || m_numMovesPlayed < m_maxMoves) {
+		if (m_board.isDraw()) {
+			co_return GameResult::DRAW;
+		}
+
+		switch (co_await m_current->getMove(m_board, &m)) {
+		case MoveResult::MOVE_OK:
+			m_board.playMove(m);
+			m_numMovesPlayed++;
+			m_current = m_current == m_white ? m_black : m_white;
+			break;
+		case MoveResult::OUT_OF_MOVES:
+			if (m_board.isKingInCheck(m_current->getColor())) { // King is in check and no moves -> Checkmate
+				co_return m_current == m_white ? GameResult::BLACK_WINS : GameResult::WHITE_WINS;
+			}
+			else { // No moves but king is not in check -> Stalemate
+				co_return GameResult::DRAW;
+			}
+		case MoveResult::OUT_OF_TIME:
+			co_return m_current == m_white ? GameResult::BLACK_WINS_TIME : GameResult::WHITE_WINS_TIME;
+		case MoveResult::REVERT_REQUEST:
+			break;
+		}
+	}
+
+	co_return GameResult::DRAW_NO_MOVES;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+class AsyncPlayer;
+class SyncPlayer;
+class AsyncGame;
+
+#include "game/game.h"
+#include "game/coroutine-task.h"
+#include "game/chess-board.h"
+
+// A player whose getMove is a coroutine, it can suspend while it waits for something, like the evaluations of a
+// batch that is shared with other games, and the thread that ran it goes on with another game
+class AsyncPlayer {
+protected:
+	Color m_color;
+
+public:
+	AsyncPlayer() = delete;
+	AsyncPlayer(Color color) : m_color(color) { }
+	virtual ~AsyncPlayer() { }
+
+	constexpr Color getColor() const { return m_color; }
+	virtual Task<MoveResult> getMove(const ChessBoard& board, BoardMove* move) = 0;
+};
+
+// Plays a Player in an AsyncGame, it never suspends
+class SyncPlayer : public AsyncPlayer {
+public:
+	SyncPlayer() = delete;
+	SyncPlayer(Player* player) : AsyncPlayer(player->getColor()), m_player(player) { }
+
+	Task<MoveResult> getMove(const ChessBoard& board, BoardMove* move) override final;
+
+private:
+	Player* m_player;
+};
+
+// Game with AsyncPlayers, play() suspends whenever the current player does. Moves are not stored,
+// a revert request asks the player for a move again
+class AsyncGame {
+public:
+	AsyncGame() = delete;
+	AsyncGame(const AsyncGame& other) = delete;
+	AsyncGame(const ChessBoard& board, AsyncPlayer* white, AsyncPlayer* black, int maxMoves)
+		: m_board(board)
+		, m_white(white)
+		, m_black(black)
+		, m_current(m_white)
+		, m_numMovesPlayed(0)
+		, m_maxMoves(maxMoves) { }
+
+	Task<GameResult> play();
+
+	inline uint getNumMovesPlayed() const {
+		return m_numMovesPlayed;
+	}
+
+private:
+	ChessBoard m_board;
+	AsyncPlayer* m_white;
+	AsyncPlayer* m_black;
+	AsyncPlayer* m_current;
+	uint m_numMovesPlayed;
+	uint m_maxMoves;
+};
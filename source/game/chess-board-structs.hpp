@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <string>
 #include "nnpp.hpp"
 
 static constexpr uint8_t BOARD_SIZE = 8;
@@ -32,6 +33,11 @@ struct TileCoords {
 	constexpr bool areOutsideBoard() const {
 		return x < 0 || y < 0; // board ranges at [0, 7]. Each coords ranges from [-7, 7]
 	}
+
+	constexpr uint8_t asIndex() const {
+		assert(areValid() && !areOutsideBoard());
+		return y * BOARD_SIZE + x;
+	}
 };
 
 enum Color : uint8_t {
@@ -137,10 +143,38 @@ struct BoardMove {
 			, from(from)
 			, to(to) { }
 
+	constexpr bool operator==(const BoardMove other) const {
+		return from == other.from && to == other.to && promotionType == other.promotionType;
+	}
+
+	constexpr bool isValid() const {
+		return from.areValid();
+	}
+
 	constexpr bool isCastle(const TileType type) const { 
 		assert(from.areValid() && to.areValid());
 		return type == KING && std::abs(from.x - to.x) == 2;
 	}
+
+	// Coordinate notation, e.g. e2e4 or e7e8q
+	inline std::string toString() const {
+		std::string str = { static_cast<char>('a' + from.x), static_cast<char>('1' + from.y),
+			static_cast<char>('a' + to.x), static_cast<char>('1' + to.y) };
+		switch (promotionType) {
+		case KNIGHT:
+			return str + 'n';
+		case BISHOP:
+			return str + 'b';
+		case ROOK:
+			return str + 'r';
+		case QUEEN:
+			return str + 'q';
+		default:
+			return str;
+		}
+	}
 };
 
+static constexpr BoardMove INVALID_MOVE = BoardMove(TileCoords(INVALID, INVALID), TileCoords(INVALID, INVALID));
+
 typedef sauce::StaticVector<BoardMove, MAX_MOVES> MovesVector;
@@ -1,5 +1,6 @@
 #include "game/chess-board.h"
 #include "tools/board-hashing.hpp"
+#include "tools/piece-square-tables.hpp"
 
 #include <iostream>
 
@@ -43,6 +44,7 @@ ChessBoard::ChessBoard()
 	}
 	
 	calculateHashFromCurrentState();
+	calculateScoresFromCurrentState();
 }
 
 ChessBoard::ChessBoard(const std::string& fen)
@@ -130,6 +132,14 @@ ChessBoard::ChessBoard(const std::string& fen)
 	}
 
 	calculateHashFromCurrentState();
+	calculateScoresFromCurrentState();
+}
+
+ChessBoard::ChessBoard(const PackedBoard& packed)
+		: m_positionData(packed.positionData) {
+	memcpy(m_tileData, packed.tiles, sizeof(m_tileData));
+	calculateHashFromCurrentState();
+	calculateScoresFromCurrentState();
 }
 
 void ChessBoard::printBoard() const {
@@ -224,14 +234,19 @@ void ChessBoard::playMove(const BoardMove move) {
 // Although this does the same, remove piece will perform an extra check when debugging that's useful
 // so we keep it like this, even though it's duplicated (this can be improved later)
 	const auto removeAndUpdateHash = [this](const TileCoords coords) {
+		updateScores(getTile(coords), BoardTile(0), coords);
+		updatePawnHash(getTile(coords), coords);
 		m_hash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(getTile(coords), coords);
 		removePiece(coords);
 		m_hash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(BoardTile(0), coords);
 	};
 
 	const auto setAndUpdateHash = [this](const TileCoords coords, const BoardTile tile) {
+		updateScores(getTile(coords), tile, coords);
+		updatePawnHash(getTile(coords), coords);
 		m_hash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(getTile(coords), coords);
 		setTile(coords, tile);
+		updatePawnHash(tile, coords);
 		m_hash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(tile, coords);
 	};
 
@@ -335,6 +350,17 @@ void ChessBoard::playMove(const BoardMove move) {
 	updatePlayerColorAndHash();
 }
 
+void ChessBoard::playNullMove() {
+	if (m_positionInfo.enPassantSquare.areValid()) {
+		m_hash ^= boardhashing::BOARD_HASH_TABLE.getEnPassantHashValue(m_positionInfo.enPassantSquare);
+		m_positionInfo.enPassantSquare = TileCoords(INVALID, INVALID);
+	}
+
+	m_hash ^= boardhashing::BOARD_HASH_TABLE.getNextPlayerColorHashValue(m_positionInfo.nextPlayerColor);
+	m_positionInfo.nextPlayerColor = static_cast<Color>(~m_positionInfo.nextPlayerColor);
+	m_hash ^= boardhashing::BOARD_HASH_TABLE.getNextPlayerColorHashValue(m_positionInfo.nextPlayerColor);
+}
+
 void ChessBoard::calculateHashFromCurrentState() {
 	m_hash = 0;
 	m_hash ^= boardhashing::BOARD_HASH_TABLE.getNextPlayerColorHashValue(m_positionInfo.nextPlayerColor);
@@ -347,14 +373,41 @@ void ChessBoard::calculateHashFromCurrentState() {
 		m_hash ^= boardhashing::BOARD_HASH_TABLE.getEnPassantHashValue(m_positionInfo.enPassantSquare);
 	}
 
+	m_pawnHash = 0;
 	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
 		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
 			TileCoords coords(x, y);
 			m_hash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(getTile(coords), coords);
+			updatePawnHash(getTile(coords), coords);
+		}
+	}
+}
+
+// The pawn hash uses the same random numbers as the board hash, only for the tiles with pawns
+void ChessBoard::updatePawnHash(const BoardTile tile, const TileCoords coords) {
+	if (tile.type == PAWN) {
+		m_pawnHash ^= boardhashing::BOARD_HASH_TABLE.getBoardHashValue(tile, coords);
+	}
+}
+
+void ChessBoard::calculateScoresFromCurrentState() {
+	m_midgameScore = 0;
+	m_endgameScore = 0;
+	m_gamePhase = 0;
+	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+			updateScores(BoardTile(0), getTile(x, y), TileCoords(x, y));
 		}
 	}
 }
 
+void ChessBoard::updateScores(const BoardTile oldTile, const BoardTile newTile, const TileCoords coords) {
+	const auto& table = piecesquaretables::PIECE_SQUARE_TABLE;
+	m_midgameScore += table.getMidgameValue(newTile, coords) - table.getMidgameValue(oldTile, coords);
+	m_endgameScore += table.getEndgameValue(newTile, coords) - table.getEndgameValue(oldTile, coords);
+	m_gamePhase += table.getPhaseValue(newTile) - table.getPhaseValue(oldTile);
+}
+
 bool ChessBoard::isAttacked(const Color color, const TileCoords coords) const {
 	MovesVector moves;
 	getQueenMoves(color, coords.x, coords.y, moves);
@@ -442,6 +495,18 @@ bool ChessBoard::isDraw() const {
 	return true;
 }
 
+bool ChessBoard::hasNonPawnMaterial(const Color color) const {
+	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+			const BoardTile tile = getTile(x, y);
+			if (tile.color == color && tile.type != EMPTY && tile.type != PAWN && tile.type != KING) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 TileCoords ChessBoard::findKing(Color color) const {
 	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
 		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
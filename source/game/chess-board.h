@@ -1,6 +1,7 @@
 #pragma once
 
 class ChessBoard;
+struct PackedBoard;
 
 #include "game/chess-board-structs.hpp"
 
@@ -13,10 +14,17 @@ static constexpr int8_t KING_SHORT_CASTLE_X = 6;
 static constexpr int8_t ROOK_LONG_CASTLE_X = 3;
 static constexpr int8_t ROOK_SHORT_CASTLE_X = 5;
 
+// The tiles and the position info of a board, what is left to store once the hashes and scores are dropped
+struct PackedBoard {
+	uint64_t tiles[4];
+	uint16_t positionData;
+};
+
 class ChessBoard {
 public:
 	ChessBoard();
 	ChessBoard(const std::string& fen);
+	ChessBoard(const PackedBoard& packed);
 
 	constexpr bool operator==(const ChessBoard& other) const {
 		return m_hash == other.m_hash
@@ -36,10 +44,32 @@ public:
 			|| m_tileData[3] != other.m_tileData[3];
 	}
 
+	constexpr PackedBoard pack() const {
+		return { { m_tileData[0], m_tileData[1], m_tileData[2], m_tileData[3] }, m_positionData };
+	}
+
 	constexpr uint64_t getHash() const {
 		return m_hash;
 	}
 
+	// Zobrist key of the pawns only, positions with the same pawns share it
+	constexpr uint64_t getPawnHash() const {
+		return m_pawnHash;
+	}
+
+	// Material and piece-square scores from white's point of view, kept up to date by playMove
+	constexpr int16_t getMidgameScore() const {
+		return m_midgameScore;
+	}
+
+	constexpr int16_t getEndgameScore() const {
+		return m_endgameScore;
+	}
+
+	constexpr uint8_t getGamePhase() const {
+		return m_gamePhase;
+	}
+
 	constexpr Color getNextPlayerColor() const {
 		return m_positionInfo.nextPlayerColor;
 	}
@@ -88,6 +118,10 @@ public:
 		return m_positionInfo.enPassantSquare;
 	}
 
+	constexpr bool isCapture(const BoardMove move) const {
+		return getTile(move.to).type != EMPTY || move.enPassantPawn.areValid();
+	}
+
 	constexpr bool isKingInCheck(const Color color) const {
 		const TileCoords kingCoords = findKing(color);
 		return isAttacked(color, kingCoords);
@@ -96,12 +130,15 @@ public:
 	void printBoard() const;
 	void printMoveOnBoard(const BoardMove move) const;
 	void calculateHashFromCurrentState();
+	void calculateScoresFromCurrentState();
 
 	void getMoves(const Color color, MovesVector& outMoves) const;
 	void playMove(const BoardMove move);
+	void playNullMove();
 	bool isAttacked(const Color color, const TileCoords coords) const;
 	bool isMoveValid(const BoardMove move, const TileCoords kingCoords) const;
 	bool isDraw() const;
+	bool hasNonPawnMaterial(const Color color) const;
 
 private:
 	// 4 bits for each tile: 1 bit for color, 3 bits for type
@@ -124,6 +161,10 @@ private:
 	};
 
 	uint64_t m_hash;
+	uint64_t m_pawnHash;
+	int16_t m_midgameScore;
+	int16_t m_endgameScore;
+	uint8_t m_gamePhase;
 
 	constexpr uint8_t index(const int8_t x, const int8_t y) const {
 		assert(x < BOARD_SIZE && y < BOARD_SIZE);
@@ -156,6 +197,8 @@ private:
 		removePiece(coords.x, coords.y);
 	}
 
+	void updateScores(const BoardTile oldTile, const BoardTile newTile, const TileCoords coords);
+	void updatePawnHash(const BoardTile tile, const TileCoords coords);
 	TileCoords findKing(const Color color) const;
 	void getMovesForPiece(const BoardTile tile, const uint8_t x, const uint8_t y, MovesVector& outMoves) const;
 	void getDirectionalMoves(const Color color, const int8_t sx, const int8_t sy, const int8_t dx, const int8_t dy, MovesVector& outMoves) const;
@@ -0,0 +1,78 @@
+#pragma once
+
+template <typename T> class Task;
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Lazy coroutine that returns a T. It starts when it is awaited and resumes the awaiting coroutine when it returns,
+// so a chain of awaited tasks runs like a call stack that can be suspended as a whole
+template <typename T>
+class Task {
+public:
+	struct promise_type {
+		T value{};
+		std::coroutine_handle<> continuation;
+
+		inline Task get_return_object() {
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		inline std::suspend_always initial_suspend() noexcept {
+			return { };
+		}
+
+		inline auto final_suspend() noexcept {
+			struct FinalAwaiter {
+				inline bool await_ready() noexcept {
+					return false;
+				}
+
+				inline std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+					const std::coroutine_handle<> continuation = handle.promise().continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				inline void await_resume() noexcept { }
+			};
+			return FinalAwaiter();
+		}
+
+		inline void return_value(T returned) {
+			value = std::move(returned);
+		}
+
+		inline void unhandled_exception() {
+			std::terminate();
+		}
+	};
+
+	Task() = delete;
+	Task(const Task& other) = delete;
+	Task(Task&& other) : m_handle(std::exchange(other.m_handle, nullptr)) { }
+
+	~Task() {
+		if (m_handle) {
+			m_handle.destroy();
+		}
+	}
+
+	inline bool await_ready() const noexcept {
+		return false;
+	}
+
+	inline std::coroutine_handle<> await_suspend(const std::coroutine_handle<> awaiting) noexcept {
+		m_handle.promise().continuation = awaiting;
+		return m_handle;
+	}
+
+	inline T await_resume() {
+		return std::move(m_handle.promise().value);
+	}
+
+private:
+	std::coroutine_handle<promise_type> m_handle;
+
+	explicit Task(const std::coroutine_handle<promise_type> handle) : m_handle(handle) { }
+};
@@ -0,0 +1,78 @@
+#include "game/game-scheduler.h"
+
+#include <thread>
+
+void GameScheduler::spawn(Task<GameResult>&& game, GameResult* outResult) {
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_liveGames++;
+	}
+	runGame(std::move(game), outResult);
+}
+
+void GameScheduler::addIdleHandler(std::function<bool()> handler) {
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_idleHandlers.push_back(std::move(handler));
+}
+
+void GameScheduler::schedule(const std::coroutine_handle<> handle) {
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_ready.push_back(handle);
+	}
+	m_wake.notify_one();
+}
+
+void GameScheduler::run() {
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < m_numOfThreads; ++i) {
+		threads.emplace_back(&GameScheduler::work, this);
+	}
+	work();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+GameScheduler::DetachedTask GameScheduler::runGame(Task<GameResult> game, GameResult* outResult) {
+	co_await ScheduleAwaiter { this };
+	*outResult = co_await game;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (--m_liveGames == 0) {
+		m_wake.notify_all();
+	}
+}
+
+void GameScheduler::work() {
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (m_liveGames > 0) {
+		if (!m_ready.empty()) {
+			const std::coroutine_handle<> handle = m_ready.front();
+			m_ready.pop_front();
+			m_running++;
+			lock.unlock();
+			handle.resume();
+			lock.lock();
+			m_running--;
+			continue;
+		}
+
+		// Every live game is suspended and no thread can add to the batches, flush them
+		if (m_running == 0 && !m_idle) {
+			m_idle = true;
+			const std::vector<std::function<bool()>> handlers = m_idleHandlers;
+			lock.unlock();
+			bool scheduled = false;
+			for (const std::function<bool()>& handler : handlers) {
+				scheduled |= handler();
+			}
+			lock.lock();
+			m_idle = false;
+			if (scheduled) {
+				continue;
+			}
+		}
+		m_wake.wait(lock);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+class GameScheduler;
+
+#include "game/game.h"
+#include "game/coroutine-task.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Runs many coroutine games on a few threads. A thread resumes a ready game until it suspends and takes the next
+// one, a suspended game is ready again when whatever it waits on calls schedule(). When no game is ready and no
+// thread runs one, every live game waits, then the idle handlers run, a batch evaluator flushes its pending
+// requests there so every waiting game is in the batch
+class GameScheduler {
+public:
+	GameScheduler() = delete;
+	GameScheduler(const GameScheduler& other) = delete;
+	GameScheduler(uint32_t numOfThreads)
+		: m_numOfThreads(std::max<uint32_t>(numOfThreads, 1))
+		, m_liveGames(0)
+		, m_running(0)
+		, m_idle(false) { }
+
+	// The game starts on the next run(), outResult is written when it ends. The players and anything else the
+	// game uses have to outlive that run()
+	void spawn(Task<GameResult>&& game, GameResult* outResult);
+	// The handler returns true if it scheduled a suspended game. Handlers are only called inside run()
+	void addIdleHandler(std::function<bool()> handler);
+	// Makes a suspended coroutine ready, safe to call from any thread
+	void schedule(std::coroutine_handle<> handle);
+	// Runs the spawned games on the threads and returns when all of them ended
+	void run();
+
+private:
+	// A coroutine that owns a spawned game, its frame is freed when it returns
+	struct DetachedTask {
+		struct promise_type {
+			inline DetachedTask get_return_object() { return { }; }
+			inline std::suspend_never initial_suspend() noexcept { return { }; }
+			inline std::suspend_never final_suspend() noexcept { return { }; }
+			inline void return_void() { }
+			inline void unhandled_exception() { std::terminate(); }
+		};
+	};
+
+	// Suspends the awaiting coroutine and makes it ready, it continues on a thread of run()
+	struct ScheduleAwaiter {
+		GameScheduler* scheduler;
+
+		inline bool await_ready() const noexcept { return false; }
+		inline void await_suspend(const std::coroutine_handle<> handle) const { scheduler->schedule(handle); }
+		inline void await_resume() const noexcept { }
+	};
+
+	uint32_t m_numOfThreads;
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	std::deque<std::coroutine_handle<>> m_ready;
+	std::vector<std::function<bool()>> m_idleHandlers;
+	uint64_t m_liveGames;
+	uint32_t m_running; // threads resuming a game
+	bool m_idle; // a thread runs the idle handlers
+
+	DetachedTask runGame(Task<GameResult> game, GameResult* outResult);
+	void work();
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+struct PositionRecord;
+class PositionWriter;
+class PositionReader;
+
+#include "game/chess-board.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dataset {
+
+static constexpr uint32_t FILE_VERSION = 1;
+static constexpr char FILE_MAGIC[4] = { 'C', 'A', 'I', 'D' };
+static constexpr uint32_t BUFFERED_RECORDS = 1 << 14;
+
+}
+
+// One labeled position of a dataset file, the records are written in the byte order of the machine.
+// The side to move is part of the packed board
+struct PositionRecord {
+	uint64_t tiles[4];
+	uint16_t positionData;
+	int16_t score; // search score in centipawns from white's point of view
+	int8_t result; // 1 if white won the game, -1 if black won, 0 for a draw
+	uint8_t reserved[3];
+
+	PositionRecord() = default;
+	PositionRecord(const ChessBoard& board, const int16_t score, const int8_t result)
+			: positionData(0)
+			, score(score)
+			, result(result)
+			, reserved{} {
+		const PackedBoard packed = board.pack();
+		std::memcpy(tiles, packed.tiles, sizeof(tiles));
+		positionData = packed.positionData;
+	}
+
+	inline ChessBoard getBoard() const {
+		PackedBoard packed;
+		std::memcpy(packed.tiles, tiles, sizeof(tiles));
+		packed.positionData = positionData;
+		return ChessBoard(packed);
+	}
+};
+
+static_assert(sizeof(PositionRecord) == 40);
+
+// Appends records to a dataset file, the records are buffered and written in blocks.
+// The file is complete once close() returns true or the writer is destroyed
+class PositionWriter {
+public:
+	PositionWriter() = default;
+	PositionWriter(const PositionWriter& other) = delete;
+
+	~PositionWriter() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		m_file.open(path, std::ios::binary | std::ios::trunc);
+		if (!m_file) {
+			return false;
+		}
+		m_file.write(dataset::FILE_MAGIC, sizeof(dataset::FILE_MAGIC));
+		const uint32_t header[2] = { dataset::FILE_VERSION, sizeof(PositionRecord) };
+		m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		m_buffer.reserve(dataset::BUFFERED_RECORDS);
+		m_written = 0;
+		return static_cast<bool>(m_file);
+	}
+
+	inline void write(const PositionRecord& record) {
+		m_buffer.push_back(record);
+		if (m_buffer.size() == dataset::BUFFERED_RECORDS) {
+			flush();
+		}
+	}
+
+	inline void write(const PositionRecord* records, const size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			write(records[i]);
+		}
+	}
+
+	bool close() {
+		if (!m_file.is_open()) {
+			return true;
+		}
+		flush();
+		const bool good = static_cast<bool>(m_file);
+		m_file.close();
+		return good;
+	}
+
+	inline uint64_t getWritten() const {
+		return m_written + m_buffer.size();
+	}
+
+private:
+	std::ofstream m_file;
+	std::vector<PositionRecord> m_buffer;
+	uint64_t m_written = 0;
+
+	inline void flush() {
+		m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() * sizeof(PositionRecord));
+		m_written += m_buffer.size();
+		m_buffer.clear();
+	}
+};
+
+// Reads the records of a dataset file in chunks, so a dataset larger than memory can be streamed
+class PositionReader {
+public:
+	PositionReader() = default;
+	PositionReader(const PositionReader& other) = delete;
+
+	bool open(const std::string& path) {
+		m_file.open(path, std::ios::binary);
+		char magic[sizeof(dataset::FILE_MAGIC)];
+		uint32_t header[2] = { };
+		if (!m_file.read(magic, sizeof(magic)) || std::memcmp(magic, dataset::FILE_MAGIC, sizeof(magic)) != 0
+				|| !m_file.read(reinterpret_cast<char*>(header), sizeof(header))
+				|| header[0] != dataset::FILE_VERSION || header[1] != sizeof(PositionRecord)) {
+			m_file.close();
+			return false;
+		}
+		m_firstRecord = m_file.tellg();
+		return true;
+	}
+
+	// Reads up to maxRecords records, returns how many were read, 0 at the end of the file
+	size_t read(PositionRecord* outRecords, const size_t maxRecords) {
+		m_file.read(reinterpret_cast<char*>(outRecords), maxRecords * sizeof(PositionRecord));
+		return static_cast<size_t>(m_file.gcount()) / sizeof(PositionRecord);
+	}
+
+	// Starts again from the first record
+	inline void rewind() {
+		m_file.clear();
+		m_file.seekg(m_firstRecord);
+	}
+
+private:
+	std::ifstream m_file;
+	std::streampos m_firstRecord = 0;
+};
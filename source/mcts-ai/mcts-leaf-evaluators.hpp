@@ -0,0 +1,166 @@
+#pragma once
+
+class PlayoutLeafEvaluator;
+class NNAILeafEvaluator;
+class BatchedNNAILeafEvaluator;
+
+#include "game/chess-board.h"
+#include "min-max-ai/chess-board-evaluator.hpp"
+#include "neural-net-ai/inference-batcher.h"
+#include "neural-net-ai/nnai-player.h"
+#include "tools/random-generator.h"
+
+#include <cmath>
+#include <memory>
+#include <optional>
+
+// Leaf evaluators of MCTSPlayer. A leaf evaluator has an evaluate(board, availableMoves, rgen) method that
+// returns the chance of the side to move to win, from 0 to 1. availableMoves is never empty, the tree scores
+// finished games itself. Every search thread works on its own copy of the evaluator
+
+namespace mctsleaf {
+
+// A pawn up is about 56%, a queen up about 92%
+static constexpr float EVALUATION_SCALE = 40.0f;
+
+// Evaluations are in tenths of a pawn from the point of view of the side to move
+inline float evaluationToValue(const float evaluation) {
+	return 1.0f / (1.0f + std::exp(-evaluation / EVALUATION_SCALE));
+}
+
+// The analyzer of ai packed for the leaf evaluators, nullptr when copyAnalyzer cannot copy it
+inline std::shared_ptr<const PackedNetwork> packAnalyzer(const NNAI& ai) {
+	const std::optional<DenseNetwork> analyzer = copyAnalyzer(ai);
+	return analyzer ? std::make_shared<const PackedNetwork>(*analyzer) : nullptr;
+}
+
+// Analyzer output through feedAt, for the networks packAnalyzer cannot copy. Every copy gets its own buffer
+class FeedAtAnalyzer {
+public:
+	FeedAtAnalyzer(const NNAI* ai)
+			: m_ai(ai)
+			, m_neuronBuffer(nnpp::allocNeuronBuffer<float>()) { }
+
+	FeedAtAnalyzer(const FeedAtAnalyzer& other)
+			: FeedAtAnalyzer(other.m_ai) { }
+
+	inline float feed(const nnpp::NNPPStackVector<float>& input) {
+		return m_ai->feedAt(ANALYZER_NETWORK_INDEX, input, m_neuronBuffer)[0];
+	}
+
+private:
+	const NNAI* m_ai;
+	nnpp::NeuronBuffer<float> m_neuronBuffer;
+};
+
+}
+
+// Plays random moves until the game ends, like RandomPlayer does. Long games are stopped and scored by the board's piece-square scores
+class PlayoutLeafEvaluator {
+public:
+	inline float evaluate(const ChessBoard& board, const MovesVector& availableMoves, RandomGenerator& rgen) const {
+		const Color color = board.getNextPlayerColor();
+		ChessBoard playout(board);
+		playout.playMove(availableMoves[rgen.getUint32() % availableMoves.size()]);
+		for (uint32_t ply = 1; ply < MAX_PLAYOUT_PLIES; ++ply) {
+			if (playout.isDraw()) {
+				return 0.5f;
+			}
+			MovesVector moves;
+			playout.getNextPlayerMoves(moves);
+			if (moves.empty()) {
+				if (!playout.isKingInCheck(playout.getNextPlayerColor())) {
+					return 0.5f;
+				}
+				return playout.getNextPlayerColor() == color ? 0.0f : 1.0f;
+			}
+			playout.playMove(moves[rgen.getUint32() % moves.size()]);
+		}
+		const int16_t evaluation = taperEvaluation(playout, playout.getMidgameScore(), playout.getEndgameScore());
+		return mctsleaf::evaluationToValue(color == WHITE ? evaluation : -evaluation);
+	}
+
+private:
+	static constexpr uint32_t MAX_PLAYOUT_PLIES = 200;
+};
+
+// Any MinMaxTree evaluator policy, its evaluation is turned into a chance to win
+template <typename Evaluator>
+class StaticLeafEvaluator {
+public:
+	StaticLeafEvaluator() = default;
+	StaticLeafEvaluator(const Evaluator& evaluator) : m_evaluator(evaluator) { }
+
+	inline float evaluate(const ChessBoard& board, const MovesVector& availableMoves, RandomGenerator&) {
+		const int16_t evaluation = m_evaluator.evaluate(board, availableMoves);
+		return mctsleaf::evaluationToValue(board.getNextPlayerColor() == WHITE ? evaluation : -evaluation);
+	}
+
+private:
+	Evaluator m_evaluator;
+};
+
+typedef StaticLeafEvaluator<MaterialEvaluator> MaterialLeafEvaluator;
+
+// Value of the analyzer network, compiled once to a PackedNetwork. The network is shared, every copy gets its own buffer.
+// A network that cannot be copied is fed with feedAt
+class NNAILeafEvaluator {
+public:
+	NNAILeafEvaluator() = delete;
+	NNAILeafEvaluator(const NNAI* ai)
+			: m_analyzer(mctsleaf::packAnalyzer(*ai)) {
+		if (!m_analyzer) {
+			m_feedAt.emplace(ai);
+		}
+	}
+
+	NNAILeafEvaluator(const NNAILeafEvaluator& other)
+			: m_analyzer(other.m_analyzer)
+			, m_feedAt(other.m_feedAt) { }
+
+	inline float evaluate(const ChessBoard& board, const MovesVector&, RandomGenerator&) {
+		// The output is from white's point of view
+		const nnpp::NNPPStackVector<float> input = board.asFloats();
+		const float output = m_analyzer ? m_analyzer->feed(&input[0], m_packedBuffer) : m_feedAt->feed(input);
+		const float evaluation = analyzerOutputToEvaluation(output);
+		return mctsleaf::evaluationToValue(board.getNextPlayerColor() == WHITE ? evaluation : -evaluation);
+	}
+
+private:
+	std::shared_ptr<const PackedNetwork> m_analyzer;
+	PackedBuffer m_packedBuffer;
+	std::optional<mctsleaf::FeedAtAnalyzer> m_feedAt;
+};
+
+// Same values as NNAILeafEvaluator, the leaves of all the search threads go through one InferenceBatcher.
+// numOfThreads is the number of threads of the MCTSPlayer, every copy of the evaluator shares the batcher.
+// A network that cannot be copied has no batcher, every copy feeds it with feedAt
+class BatchedNNAILeafEvaluator {
+public:
+	BatchedNNAILeafEvaluator() = delete;
+	BatchedNNAILeafEvaluator(const NNAI* ai, const uint32_t numOfThreads) {
+		std::shared_ptr<const PackedNetwork> analyzer = mctsleaf::packAnalyzer(*ai);
+		if (analyzer) {
+			m_batcher = std::make_shared<InferenceBatcher>(std::move(analyzer), numOfThreads);
+		}
+		else {
+			m_feedAt.emplace(ai);
+		}
+	}
+
+	inline float evaluate(const ChessBoard& board, const MovesVector&, RandomGenerator&) {
+		const nnpp::NNPPStackVector<float> input = board.asFloats();
+		const float output = m_batcher ? m_batcher->evaluate(&input[0]) : m_feedAt->feed(input);
+		const float evaluation = analyzerOutputToEvaluation(output);
+		return mctsleaf::evaluationToValue(board.getNextPlayerColor() == WHITE ? evaluation : -evaluation);
+	}
+
+	// Null when the network is fed with feedAt
+	inline const InferenceBatcher* getBatcher() const {
+		return m_batcher.get();
+	}
+
+private:
+	std::shared_ptr<InferenceBatcher> m_batcher;
+	std::optional<mctsleaf::FeedAtAnalyzer> m_feedAt;
+};
@@ -0,0 +1,103 @@
+#include "mcts-ai/mcts-player.h"
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+template <typename LeafEvaluator>
+MoveResult MCTSPlayer<LeafEvaluator>::getMove(const ChessBoard& board, BoardMove* move) {
+	MovesVector moves;
+	board.getMoves(m_color, moves);
+	if (moves.empty()) {
+		return MoveResult::OUT_OF_MOVES;
+	}
+	if (moves.size() == 1) {
+		*move = moves[0];
+		return MoveResult::MOVE_OK;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	m_tree.reset();
+	m_tree.tryExpand(0, moves);
+	m_nextSimulation = 0;
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < m_numOfThreads; ++i) {
+		threads.emplace_back(&MCTSPlayer::runSimulations, this, std::cref(board), m_leafEvaluator, i);
+	}
+	runSimulations(board, m_leafEvaluator, 0);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const MCTSNode& best = m_tree.getNode(m_tree.getMostVisitedRootChild());
+	*move = best.move;
+
+	if (m_printStats) {
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const MCTSNode& root = m_tree.getNode(0);
+		for (uint32_t child = root.firstChild; child < root.firstChild + root.numOfChildren; ++child) {
+			const MCTSNode& node = m_tree.getNode(child);
+			const uint32_t visits = node.visits.load();
+			board.printMoveOnBoard(node.move);
+			std::cout << " -> Visits: " << visits << ", value: " << (visits > 0 ? node.valueSum.load() / visits : 0.0f) << '\n';
+		}
+		std::cout << "Simulations: " << getRootVisits() << ", nodes: " << m_tree.getSize()
+			<< ", simulations/sec: " << static_cast<uint64_t>(seconds > 0.0 ? getRootVisits() / seconds : 0.0)
+			<< ", time: " << seconds << "s" << '\n';
+	}
+	return MoveResult::MOVE_OK;
+}
+
+template <typename LeafEvaluator>
+void MCTSPlayer<LeafEvaluator>::runSimulations(const ChessBoard& board, LeafEvaluator leafEvaluator, uint32_t thread) {
+	RandomGenerator rgen = m_options.seed == 0 ? RandomGenerator() : RandomGenerator(m_options.seed + thread);
+	while (m_nextSimulation.fetch_add(1, std::memory_order_relaxed) < m_options.simulations) {
+		simulate(board, leafEvaluator, rgen);
+	}
+}
+
+template <typename LeafEvaluator>
+void MCTSPlayer<LeafEvaluator>::simulate(const ChessBoard& rootBoard, LeafEvaluator& leafEvaluator, RandomGenerator& rgen) {
+	std::array<uint32_t, MAX_SELECTION_DEPTH> path;
+	uint32_t pathLength = 0;
+	ChessBoard board(rootBoard);
+
+	// Selection, down to a node without children: a leaf, a finished game or a node another thread is expanding
+	uint32_t index = 0;
+	path[pathLength++] = index;
+	m_tree.addVirtualLoss(index);
+	while (pathLength < MAX_SELECTION_DEPTH && m_tree.isExpanded(index) && m_tree.getNode(index).numOfChildren > 0) {
+		index = m_tree.selectChild(index, m_options.explorationConstant);
+		board.playMove(m_tree.getNode(index).move);
+		path[pathLength++] = index;
+		m_tree.addVirtualLoss(index);
+	}
+
+	// Expansion and evaluation, the value is for the side to move in the leaf
+	MovesVector moves;
+	board.getNextPlayerMoves(moves);
+	float value = 0.5f;
+	if (moves.empty()) {
+		m_tree.tryExpand(index, moves);
+		value = board.isKingInCheck(board.getNextPlayerColor()) ? 0.0f : 0.5f;
+	}
+	else if (!board.isDraw()) {
+		m_tree.tryExpand(index, moves);
+		value = leafEvaluator.evaluate(board, moves, rgen);
+	}
+
+	// Backup, every node keeps the value of the player that moved into it
+	for (uint32_t i = pathLength; i > 0; --i) {
+		value = 1.0f - value;
+		m_tree.update(path[i - 1], value);
+	}
+}
+
+template class MCTSPlayer<PlayoutLeafEvaluator>;
+template class MCTSPlayer<MaterialLeafEvaluator>;
+template class MCTSPlayer<StaticLeafEvaluator<PieceSquareEvaluator>>;
+template class MCTSPlayer<NNAILeafEvaluator>;
+template class MCTSPlayer<BatchedNNAILeafEvaluator>;
@@ -0,0 +1,63 @@
+#pragma once
+
+template <typename LeafEvaluator> class MCTSPlayer;
+
+#include "game/player.h"
+#include "mcts-ai/mcts-tree.h"
+#include "mcts-ai/mcts-leaf-evaluators.hpp"
+#include "tools/random-generator.h"
+
+#include <atomic>
+#include <type_traits>
+
+struct MCTSOptions {
+	uint32_t simulations = 20000; // for every move, split between the threads
+	float explorationConstant = 1.4f;
+	uint32_t poolNodes = DEFAULT_MCTS_POOL_NODES;
+	uint64_t seed = 0; // search thread i uses seed + i, 0 seeds every thread from the random device
+};
+
+// Monte Carlo tree search player. Every simulation walks the tree by UCT, adds the children of the leaf it
+// reaches and backs up the value LeafEvaluator gives for it. Threads share one tree, a thread leaves a virtual
+// loss on its path so the others spread out. The leaf evaluators in mcts-leaf-evaluators.hpp are compiled
+// in mcts-player.cpp, any other one has to be added there
+template <typename LeafEvaluator = MaterialLeafEvaluator>
+class MCTSPlayer : public Player {
+public:
+	MCTSPlayer(Color color, bool printStats, uint32_t numOfThreads)
+	requires std::is_default_constructible_v<LeafEvaluator>
+		: MCTSPlayer(color, printStats, numOfThreads, LeafEvaluator()) { }
+
+	MCTSPlayer(Color color, bool printStats, uint32_t numOfThreads, const LeafEvaluator& leafEvaluator, const MCTSOptions& options = MCTSOptions())
+		: Player(color)
+		, m_tree(options.poolNodes)
+		, m_options(options)
+		, m_leafEvaluator(leafEvaluator)
+		, m_printStats(printStats)
+		, m_numOfThreads(std::max<uint32_t>(numOfThreads, 1))
+		, m_nextSimulation(0) { }
+
+	MoveResult getMove(const ChessBoard& board, BoardMove* move) override;
+
+	// Simulations of the last search
+	inline uint32_t getRootVisits() const {
+		return m_tree.getNode(0).visits.load(std::memory_order_relaxed);
+	}
+
+	inline uint32_t getTreeSize() const {
+		return m_tree.getSize();
+	}
+
+private:
+	static constexpr uint32_t MAX_SELECTION_DEPTH = 256;
+
+	MCTSTree m_tree;
+	MCTSOptions m_options;
+	LeafEvaluator m_leafEvaluator; // copied to every search thread
+	bool m_printStats;
+	uint32_t m_numOfThreads;
+	std::atomic<uint32_t> m_nextSimulation;
+
+	void runSimulations(const ChessBoard& board, LeafEvaluator leafEvaluator, uint32_t thread);
+	void simulate(const ChessBoard& rootBoard, LeafEvaluator& leafEvaluator, RandomGenerator& rgen);
+};
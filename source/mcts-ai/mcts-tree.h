@@ -0,0 +1,157 @@
+#pragma once
+
+class MCTSTree;
+
+#include "game/chess-board.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+static constexpr uint32_t DEFAULT_MCTS_POOL_NODES = 1 << 20;
+
+enum MCTSNodeState : uint8_t {
+	NODE_LEAF,
+	NODE_EXPANDING, // a thread is adding the children, or the pool ran out while it did, others treat it as a leaf
+	NODE_EXPANDED, // a node without children is the end of the game
+};
+
+// Node of the search tree. The children of a node are next to each other in the pool so a selection
+// walks one contiguous range. Values are from the point of view of the player that played move, 1 is a win
+struct MCTSNode {
+	BoardMove move;
+	uint32_t firstChild;
+	uint16_t numOfChildren;
+	std::atomic<uint8_t> state;
+	std::atomic<uint32_t> visits;
+	std::atomic<uint32_t> virtualLosses; // threads that are below the node right now, each counts as a lost visit
+	std::atomic<float> valueSum;
+};
+
+// UCT tree in a fixed pool of nodes, shared by all the search threads without locks.
+// Nodes are only added, the pool is reset when a new search starts
+class MCTSTree {
+public:
+	MCTSTree() : MCTSTree(DEFAULT_MCTS_POOL_NODES) { }
+	MCTSTree(const uint32_t poolNodes)
+			: m_pool(std::make_unique<MCTSNode[]>(poolNodes))
+			, m_capacity(poolNodes)
+			, m_size(0) {
+		assert(poolNodes > 0);
+		reset();
+	}
+
+	inline void reset() {
+		initNode(0, INVALID_MOVE);
+		m_size = 1;
+	}
+
+	inline MCTSNode& getNode(const uint32_t index) {
+		assert(index < m_capacity);
+		return m_pool[index];
+	}
+
+	inline const MCTSNode& getNode(const uint32_t index) const {
+		assert(index < m_capacity);
+		return m_pool[index];
+	}
+
+	inline MCTSNode& getRoot() {
+		return m_pool[0];
+	}
+
+	inline uint32_t getSize() const {
+		return std::min(m_size.load(std::memory_order_relaxed), m_capacity);
+	}
+
+	inline bool isExpanded(const uint32_t index) const {
+		return m_pool[index].state.load(std::memory_order_acquire) == NODE_EXPANDED;
+	}
+
+	// Only the first thread to reach a leaf adds its children, the others keep treating it as a leaf until it is done
+	inline bool tryExpand(const uint32_t index, const MovesVector& moves) {
+		MCTSNode& node = m_pool[index];
+		uint8_t expected = NODE_LEAF;
+		if (!node.state.compare_exchange_strong(expected, NODE_EXPANDING, std::memory_order_acq_rel)) {
+			return false;
+		}
+
+		const uint32_t firstChild = m_size.fetch_add(moves.size(), std::memory_order_relaxed);
+		if (firstChild + moves.size() > m_capacity) {
+			return false;
+		}
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			initNode(firstChild + i, moves[i]);
+		}
+		node.firstChild = firstChild;
+		node.numOfChildren = moves.size();
+		node.state.store(NODE_EXPANDED, std::memory_order_release);
+		return true;
+	}
+
+	// The child with the best upper confidence bound, children nobody has visited yet come first
+	inline uint32_t selectChild(const uint32_t index, const float explorationConstant) const {
+		const MCTSNode& node = m_pool[index];
+		assert(isExpanded(index) && node.numOfChildren > 0);
+		const uint32_t parentVisits = node.visits.load(std::memory_order_relaxed) + node.virtualLosses.load(std::memory_order_relaxed);
+		const float exploration = explorationConstant * std::sqrt(std::log(static_cast<float>(std::max<uint32_t>(parentVisits, 1))));
+
+		uint32_t bestChild = node.firstChild;
+		float bestScore = -1.0f;
+		for (uint32_t child = node.firstChild; child < node.firstChild + node.numOfChildren; ++child) {
+			const MCTSNode& childNode = m_pool[child];
+			const uint32_t visits = childNode.visits.load(std::memory_order_relaxed) + childNode.virtualLosses.load(std::memory_order_relaxed);
+			if (visits == 0) {
+				return child;
+			}
+			const float score = childNode.valueSum.load(std::memory_order_relaxed) / visits + exploration / std::sqrt(static_cast<float>(visits));
+			if (score > bestScore) {
+				bestScore = score;
+				bestChild = child;
+			}
+		}
+		return bestChild;
+	}
+
+	inline void addVirtualLoss(const uint32_t index) {
+		m_pool[index].virtualLosses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Takes back the virtual loss and adds the real result, value is from the point of view of the player that played the node's move
+	inline void update(const uint32_t index, const float value) {
+		MCTSNode& node = m_pool[index];
+		node.valueSum.fetch_add(value, std::memory_order_relaxed);
+		node.visits.fetch_add(1, std::memory_order_relaxed);
+		node.virtualLosses.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	// The most visited move of the root, the number of visits is what the search trusts, not the average value
+	inline uint32_t getMostVisitedRootChild() const {
+		const MCTSNode& root = m_pool[0];
+		assert(isExpanded(0) && root.numOfChildren > 0);
+		uint32_t best = root.firstChild;
+		for (uint32_t child = root.firstChild + 1; child < root.firstChild + root.numOfChildren; ++child) {
+			if (m_pool[child].visits.load(std::memory_order_relaxed) > m_pool[best].visits.load(std::memory_order_relaxed)) {
+				best = child;
+			}
+		}
+		return best;
+	}
+
+private:
+	std::unique_ptr<MCTSNode[]> m_pool;
+	uint32_t m_capacity;
+	std::atomic<uint32_t> m_size;
+
+	inline void initNode(const uint32_t index, const BoardMove move) {
+		MCTSNode& node = m_pool[index];
+		node.move = move;
+		node.firstChild = 0;
+		node.numOfChildren = 0;
+		node.state.store(NODE_LEAF, std::memory_order_relaxed);
+		node.visits.store(0, std::memory_order_relaxed);
+		node.virtualLosses.store(0, std::memory_order_relaxed);
+		node.valueSum.store(0.0f, std::memory_order_relaxed);
+	}
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "game/chess-board.h"
+#include "tools/piece-square-tables.hpp"
+
+#include <algorithm>
 
 // Max evaluation is 9 queens (8 promoted pawns + 1 queen), 2 rooks, 2 bishops, 2 knights
 // Total points = +- (9 * 10 + 2 * 5 + 2 * 3 + 2 * 2) * 10 = +-1100
@@ -9,35 +12,75 @@
 static const int16_t CHESS_BOARD_MAX_EVALUATION = 10000;
 static const int16_t CHESS_BOARD_MIN_EVALUATION = -10000;
 
+constexpr bool isMateEvaluation(const int16_t evaluation) {
+	return evaluation >= CHESS_BOARD_MAX_EVALUATION || evaluation <= CHESS_BOARD_MIN_EVALUATION;
+}
+
+// Checkmate or stalemate, for positions without available moves
+inline int16_t evaluateTerminal(const ChessBoard& board) {
+	// It is checkmate
+	if (board.isKingInCheck(board.getNextPlayerColor())) {
+		return board.getNextPlayerColor() == WHITE ? CHESS_BOARD_MIN_EVALUATION : CHESS_BOARD_MAX_EVALUATION;
+	}
+	// it is stalemate
+	return 0;
+}
+
+// Blends midgame and endgame scores as pieces leave the board
+inline int16_t taperEvaluation(const ChessBoard& board, const int32_t midgameScore, const int32_t endgameScore) {
+	const int32_t phase = std::min<int32_t>(board.getGamePhase(), piecesquaretables::MAX_GAME_PHASE);
+	return static_cast<int16_t>((midgameScore * phase + endgameScore * (piecesquaretables::MAX_GAME_PHASE - phase))
+		/ piecesquaretables::MAX_GAME_PHASE);
+}
+
 inline int16_t evaluate(const ChessBoard& board, const MovesVector& availableMoves) {
 	if (availableMoves.empty()) {
-		// It is checkmate
-		if (board.isKingInCheck(board.getNextPlayerColor())) {
-			return board.getNextPlayerColor() == WHITE ? CHESS_BOARD_MIN_EVALUATION : CHESS_BOARD_MAX_EVALUATION;
-		}
-		// it is stalemate
-		return 0;
+		return evaluateTerminal(board);
 	}
 
-	auto getEvalForPiece = [](const BoardTile& tile) {
-		switch (tile.type)
-		{
-		case PAWN:		return 10;
-		case KNIGHT: 	return 30;
-		case BISHOP: 	return 35;
-		case ROOK: 		return 50;
-		case QUEEN: 	return 100;
-		default: 		return 0;
+	// Material and piece-square scores are kept by the board as moves are played
+	return taperEvaluation(board, board.getMidgameScore(), board.getEndgameScore());
+}
+
+// Evaluator policies of MinMaxTree. A policy has an evaluate(board, availableMoves) method that returns
+// the evaluation from white's point of view. The tree calls it directly, the policy is known at compile time.
+// Evaluations are cached by the tree, a policy cheaper than a cache lookup sets CACHE_EVALUATIONS to false
+template <typename Evaluator>
+constexpr bool shouldCacheEvaluations() {
+	if constexpr (requires { Evaluator::CACHE_EVALUATIONS; }) {
+		return Evaluator::CACHE_EVALUATIONS;
+	}
+	else {
+		return true;
+	}
+}
+
+// Counts only the material on the board
+struct MaterialEvaluator {
+	static constexpr bool CACHE_EVALUATIONS = true;
+
+	inline int16_t evaluate(const ChessBoard& board, const MovesVector& availableMoves) const {
+		if (availableMoves.empty()) {
+			return evaluateTerminal(board);
 		}
-	};
-
-	int16_t evaluation = 0;
-	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
-		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
-			const BoardTile tile = board.getTile(x, y);
-			const int16_t colorValue = tile.color == WHITE ? 1 : -1;
-			evaluation += colorValue * getEvalForPiece(tile);
+
+		int16_t evaluation = 0;
+		for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+			for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+				const BoardTile tile = board.getTile(x, y);
+				const int16_t colorValue = tile.color == WHITE ? 1 : -1;
+				evaluation += colorValue * piecesquaretables::MATERIAL[tile.type];
+			}
 		}
+		return evaluation;
+	}
+};
+
+// Material and tapered piece-square scores kept by the board
+struct PieceSquareEvaluator {
+	static constexpr bool CACHE_EVALUATIONS = false; // the board already keeps the scores
+
+	inline int16_t evaluate(const ChessBoard& board, const MovesVector& availableMoves) const {
+		return ::evaluate(board, availableMoves);
 	}
-	return evaluation;
-}
\ No newline at end of file
+};
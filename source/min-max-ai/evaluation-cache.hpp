@@ -0,0 +1,47 @@
+#pragma once
+
+class EvaluationCache;
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+static constexpr uint32_t DEFAULT_EVALUATION_CACHE_ENTRIES = 1 << 16;
+
+// Direct mapped cache of static evaluations, owned by a single search thread so it needs no locking.
+// Each entry packs the upper 48 bits of the hash with the 16 bit evaluation, a newer position simply overwrites the old one
+class EvaluationCache {
+public:
+	EvaluationCache() : EvaluationCache(DEFAULT_EVALUATION_CACHE_ENTRIES) { }
+	EvaluationCache(const uint32_t entries) {
+		uint32_t size = 1;
+		while (size * 2 <= entries) {
+			size *= 2;
+		}
+		m_entries.resize(size, EMPTY_ENTRY);
+	}
+
+	inline void clear() {
+		std::fill(m_entries.begin(), m_entries.end(), EMPTY_ENTRY);
+	}
+
+	inline bool probe(const uint64_t hash, int16_t& outEvaluation) const {
+		const uint64_t entry = m_entries[hash & (m_entries.size() - 1)];
+		if (((entry ^ hash) & KEY_MASK) != 0) {
+			return false;
+		}
+		outEvaluation = static_cast<int16_t>(entry & EVALUATION_MASK);
+		return true;
+	}
+
+	inline void store(const uint64_t hash, const int16_t evaluation) {
+		m_entries[hash & (m_entries.size() - 1)] = (hash & KEY_MASK) | static_cast<uint16_t>(evaluation);
+	}
+
+private:
+	static constexpr uint64_t EVALUATION_MASK = 0xffff;
+	static constexpr uint64_t KEY_MASK = ~EVALUATION_MASK;
+	static constexpr uint64_t EMPTY_ENTRY = KEY_MASK; // a real position matching all 48 key bits is unlikely enough to ignore
+
+	std::vector<uint64_t> m_entries;
+};
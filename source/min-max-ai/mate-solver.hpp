@@ -0,0 +1,325 @@
+#pragma once
+
+class MateSolver;
+
+#include "game/chess-board.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <vector>
+
+static constexpr size_t DEFAULT_MATE_TABLE_MB = 16;
+static constexpr uint64_t DEFAULT_MATE_SOLVER_NODES = 10000000;
+static constexpr uint32_t MAX_MATE_PLIES = 120; // recursion limit, also the horizon of a search without a move limit
+
+enum class MateStatus {
+	MATE, // the side to move mates in every line
+	NO_MATE, // the defender escapes, or the attacker gets mated or stalemated
+	UNKNOWN, // the node budget ran out first, or only lines past MAX_MATE_PLIES were left
+};
+
+struct MateResult {
+	MateStatus status = MateStatus::UNKNOWN;
+	uint32_t mateInMoves = 0; // length of the proven mate, not always the shortest one
+	std::vector<BoardMove> moves; // both sides, the fastest mate against the longest defence, as far as the table still has it
+	uint64_t nodes = 0;
+};
+
+// Depth-first proof-number search for forced mates by the side to move.
+// Every node keeps phi and delta from the point of view of its side to move: phi is the number of leaves
+// that have to be proven to show the side to move wins, delta the number to show it loses. The attacker wins
+// by mating, the defender wins by escaping. The search only descends while the numbers stay under thresholds,
+// so memory is bounded by the table and time by the node budget, not by the length of the mate.
+// Positions on the current path count as a draw and are not stored, draws by repetition can still leak
+// through the table into other paths (the graph history interaction problem), which is accepted here.
+// Without a move limit, positions at MAX_MATE_PLIES are neither proven nor disproven, they only get numbers
+// too high to ever be worth expanding
+class MateSolver {
+public:
+	MateSolver() : MateSolver(DEFAULT_MATE_TABLE_MB) { }
+	MateSolver(const size_t sizeInMB)
+			: m_attacker(WHITE)
+			, m_depthLimited(false)
+			, m_nodes(0)
+			, m_maxNodes(0) {
+		size_t buckets = 1;
+		while (buckets * 2 * sizeof(Bucket) <= sizeInMB * 1024 * 1024) {
+			buckets *= 2;
+		}
+		m_buckets.resize(buckets);
+	}
+
+	// Looks for a mate in at most maxMoves moves, 0 for no limit
+	MateResult solve(const ChessBoard& board, const uint32_t maxMoves, const uint64_t maxNodes) {
+		clear();
+		m_attacker = board.getNextPlayerColor();
+		m_depthLimited = maxMoves > 0 && 2 * maxMoves - 1 <= MAX_MATE_PLIES;
+		m_nodes = 0;
+		m_maxNodes = maxNodes;
+		m_path.clear();
+
+		// The root stops at UNPROVABLE_NUMBER too, that is all a tree cut by the horizon can reach
+		const int32_t rootPlies = m_depthLimited ? 2 * maxMoves - 1 : MAX_MATE_PLIES;
+		const uint64_t rootKey = keyOf(board, rootPlies);
+		m_path.push_back(board.getHash());
+		search(board, rootKey, rootPlies, UNPROVABLE_NUMBER, UNPROVABLE_NUMBER);
+		m_path.clear();
+
+		MateResult result;
+		result.nodes = m_nodes;
+		const Entry* root = probe(rootKey);
+		if (root == nullptr || (root->phi != 0 && root->delta != 0)) {
+			return result;
+		}
+		if (root->delta == 0) {
+			result.status = MateStatus::NO_MATE;
+			return result;
+		}
+		result.status = MateStatus::MATE;
+		result.mateInMoves = (root->distance + 1) / 2;
+		extractLine(board, rootPlies, root->distance, result.moves);
+		return result;
+	}
+
+	inline uint64_t getNodes() const {
+		return m_nodes;
+	}
+
+private:
+	static constexpr uint32_t INFINITE_NUMBER = 1 << 28;
+	static constexpr uint32_t UNPROVABLE_NUMBER = INFINITE_NUMBER - 1; // sums saturate here, only 0 and INFINITE_NUMBER are results
+	static constexpr uint16_t NO_DISTANCE = std::numeric_limits<uint16_t>::max();
+	static constexpr uint32_t BUCKET_SIZE = 4;
+
+	struct Entry {
+		uint64_t key;
+		uint32_t phi;
+		uint32_t delta;
+		uint32_t work; // nodes spent under the entry, the cheapest entry of a bucket is replaced first
+		uint16_t distance; // plies to the end of the game of a solved node
+	};
+
+	struct Bucket {
+		std::array<Entry, BUCKET_SIZE> entries;
+	};
+
+	struct Numbers {
+		uint32_t phi;
+		uint32_t delta;
+		uint16_t distance;
+	};
+
+	std::vector<Bucket> m_buckets;
+	std::vector<uint64_t> m_path; // board hashes from the root to the current node
+	Color m_attacker;
+	bool m_depthLimited;
+	uint64_t m_nodes;
+	uint64_t m_maxNodes;
+
+	static constexpr Numbers won() {
+		return { 0, INFINITE_NUMBER, 0 };
+	}
+
+	static constexpr Numbers lost() {
+		return { INFINITE_NUMBER, 0, 0 };
+	}
+
+	static constexpr Numbers unprovable() {
+		return { UNPROVABLE_NUMBER, UNPROVABLE_NUMBER, 0 };
+	}
+
+	static constexpr uint32_t add(const uint32_t a, const uint32_t b) {
+		if (a >= INFINITE_NUMBER || b >= INFINITE_NUMBER) {
+			return INFINITE_NUMBER;
+		}
+		return std::min(a + b, INFINITE_NUMBER - 1);
+	}
+
+	inline void clear() {
+		for (Bucket& bucket : m_buckets) {
+			for (Entry& entry : bucket.entries) {
+				entry = { 0, 0, 0, 0, 0 };
+			}
+		}
+	}
+
+	// A proof with a move limit only holds for the plies left, so those are part of the key
+	inline uint64_t keyOf(const ChessBoard& board, const int32_t plies) const {
+		const uint64_t key = m_depthLimited ? board.getHash() ^ (static_cast<uint64_t>(plies) * 0x9e3779b97f4a7c15ull) : board.getHash();
+		return key == 0 ? 1 : key; // 0 marks an empty entry
+	}
+
+	inline Bucket& bucketOf(const uint64_t key) {
+		return m_buckets[key & (m_buckets.size() - 1)];
+	}
+
+	inline const Entry* probe(const uint64_t key) {
+		for (const Entry& entry : bucketOf(key).entries) {
+			if (entry.key == key) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	inline void store(const uint64_t key, const Numbers numbers, const uint32_t work) {
+		Bucket& bucket = bucketOf(key);
+		Entry* replace = &bucket.entries[0];
+		for (Entry& entry : bucket.entries) {
+			if (entry.key == key) {
+				replace = &entry;
+				break;
+			}
+			if (entry.work < replace->work) {
+				replace = &entry;
+			}
+		}
+		*replace = { key, numbers.phi, numbers.delta, work, numbers.distance };
+	}
+
+	// Leaves are known without looking at the children
+	inline bool isLeaf(const ChessBoard& board, const MovesVector& moves, const int32_t plies, Numbers& outNumbers) const {
+		const bool isAttacker = board.getNextPlayerColor() == m_attacker;
+		if (moves.empty()) {
+			// Checkmate loses for both sides, stalemate is a draw and only the defender is happy with it
+			outNumbers = board.isKingInCheck(board.getNextPlayerColor()) || isAttacker ? lost() : won();
+			return true;
+		}
+		if (board.isDraw() || (plies <= 0 && m_depthLimited)) {
+			outNumbers = isAttacker ? lost() : won();
+			return true;
+		}
+		if (plies <= 0) {
+			outNumbers = unprovable();
+			return true;
+		}
+		return false;
+	}
+
+	inline Numbers childNumbers(const uint64_t childHash, const uint64_t childKey, const bool isChildAttacker) {
+		if (std::find(m_path.begin(), m_path.end(), childHash) != m_path.end()) {
+			return isChildAttacker ? lost() : won();
+		}
+		const Entry* entry = probe(childKey);
+		if (entry == nullptr) {
+			return { 1, 1, 0 };
+		}
+		return { entry->phi, entry->delta, entry->distance };
+	}
+
+	void search(const ChessBoard& board, const uint64_t key, const int32_t plies, const uint32_t phiThreshold, const uint32_t deltaThreshold) {
+		const uint64_t startNodes = m_nodes++;
+		MovesVector moves;
+		board.getNextPlayerMoves(moves);
+		Numbers leaf;
+		if (isLeaf(board, moves, plies, leaf)) {
+			store(key, leaf, 1);
+			return;
+		}
+
+		const bool isChildAttacker = board.getNextPlayerColor() != m_attacker;
+		std::array<uint64_t, MAX_MOVES> childHashes;
+		std::array<uint64_t, MAX_MOVES> childKeys;
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			ChessBoard child(board);
+			child.playMove(moves[i]);
+			childHashes[i] = child.getHash();
+			childKeys[i] = keyOf(child, plies - 1);
+			if (isChildAttacker) {
+				continue;
+			}
+
+			// Checks are looked at one ply deeper so a mate in one is never missed for a longer one
+			if (!child.isKingInCheck(child.getNextPlayerColor())) {
+				continue;
+			}
+			MovesVector replies;
+			child.getNextPlayerMoves(replies);
+			Numbers numbers;
+			if (replies.empty() && isLeaf(child, replies, plies - 1, numbers)) {
+				store(childKeys[i], numbers, 1);
+			}
+		}
+
+		while (true) {
+			// phi is the smallest delta of the children, delta the sum of their phi
+			Numbers numbers = { INFINITE_NUMBER, 0, 0 };
+			uint32_t bestIndex = 0;
+			uint32_t bestPhi = 0;
+			uint32_t secondDelta = INFINITE_NUMBER;
+			uint16_t winDistance = NO_DISTANCE;
+			uint16_t lossDistance = 0;
+			for (uint32_t i = 0; i < moves.size(); ++i) {
+				const Numbers c = childNumbers(childHashes[i], childKeys[i], isChildAttacker);
+				numbers.delta = add(numbers.delta, c.phi);
+				if (c.delta < numbers.phi) {
+					secondDelta = numbers.phi;
+					numbers.phi = c.delta;
+					bestIndex = i;
+					bestPhi = c.phi;
+				}
+				else if (c.delta < secondDelta) {
+					secondDelta = c.delta;
+				}
+				if (c.delta == 0) {
+					winDistance = std::min<uint16_t>(winDistance, c.distance + 1);
+				}
+				lossDistance = std::max<uint16_t>(lossDistance, c.distance + 1);
+			}
+
+			if (numbers.phi == 0) {
+				numbers.delta = INFINITE_NUMBER;
+				numbers.distance = winDistance;
+			}
+			else if (numbers.delta == 0) {
+				numbers.phi = INFINITE_NUMBER;
+				numbers.distance = lossDistance;
+			}
+
+			if (numbers.phi >= phiThreshold || numbers.delta >= deltaThreshold || m_nodes >= m_maxNodes) {
+				store(key, numbers, static_cast<uint32_t>(std::min<uint64_t>(m_nodes - startNodes, INFINITE_NUMBER)));
+				return;
+			}
+
+			// The best child may use the delta the siblings leave over, and only until the second best catches up
+			const uint32_t childPhiThreshold = deltaThreshold >= INFINITE_NUMBER ? INFINITE_NUMBER : deltaThreshold - numbers.delta + bestPhi;
+			const uint32_t childDeltaThreshold = std::min(phiThreshold, secondDelta + 1);
+			ChessBoard child(board);
+			child.playMove(moves[bestIndex]);
+			m_path.push_back(childHashes[bestIndex]);
+			search(child, childKeys[bestIndex], plies - 1, childPhiThreshold, childDeltaThreshold);
+			m_path.pop_back();
+		}
+	}
+
+	// The attacker takes the fastest proven mate, the defender the slowest one
+	void extractLine(const ChessBoard& root, int32_t plies, const uint16_t distance, std::vector<BoardMove>& outMoves) {
+		ChessBoard board(root);
+		for (uint16_t ply = 0; ply < distance; ++ply, --plies) {
+			MovesVector moves;
+			board.getNextPlayerMoves(moves);
+			const bool isAttacker = board.getNextPlayerColor() == m_attacker;
+			int32_t bestIndex = -1;
+			uint16_t bestDistance = 0;
+			for (uint32_t i = 0; i < moves.size(); ++i) {
+				ChessBoard child(board);
+				child.playMove(moves[i]);
+				const Entry* entry = probe(keyOf(child, plies - 1));
+				if (entry == nullptr) {
+					continue;
+				}
+				const bool isMating = isAttacker ? entry->delta == 0 : entry->phi == 0;
+				if (isMating && (bestIndex < 0 || (isAttacker ? entry->distance < bestDistance : entry->distance > bestDistance))) {
+					bestIndex = i;
+					bestDistance = entry->distance;
+				}
+			}
+			if (bestIndex < 0) {
+				return;
+			}
+			outMoves.push_back(moves[bestIndex]);
+			board.playMove(moves[bestIndex]);
+		}
+	}
+};
@@ -1,80 +1,375 @@
 #include "min-max-ai/min-max-ai-player.h"
+#include "neural-net-ai/nnai-evaluator.h"
 
-MoveResult MinMaxAiPlayer::getMove(const ChessBoard& board, BoardMove* move) {
-	/*
-	const auto getBetterEvalAndSwapIndices = [](Color color, ChessBoardEvalType newEval,
-			ChessBoardEvalType currentBest, uint8_t newIndex, uint8_t* currentBestIndex) {
-		// We are adding some randomness to same evaluated positions so the ai can have variaety 
-		// This is also affected by what eval has each thread checked locally
-		ChessBoardEvalType paddedNewEval = newEval;
-		bool shouldSwap = (color == WHITE && paddedNewEval > currentBest) || (color == BLACK && paddedNewEval < currentBest);
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
 
-		if (shouldSwap) {
-			*currentBestIndex = *newIndex;
-			return newEval;
+template <typename Evaluator>
+MoveResult MinMaxAiPlayer<Evaluator>::getMove(const ChessBoard& board, BoardMove* move) {
+	// On a ponder hit the background search is already searching this position, it gets the move time to finish
+	const bool isPonderHit = m_ponderThread.joinable() && board == m_ponderPosition;
+	if (isPonderHit) {
+		if (m_moveTime.count() > 0) {
+			m_minMaxTree.setDeadline(std::chrono::steady_clock::now() + m_moveTime);
 		}
-		return currentBest;
-	};
-	*/
+		m_ponderThread.join();
+		m_minMaxTree.clearDeadline();
+		m_minMaxTree.clearStop();
+	}
+	else {
+		stopPondering();
+	}
 
 	MovesVector moves;
 	board.getMoves(m_color, moves);
 
+	m_isLastMovePonderHit = false;
 	if (moves.empty()) {
 		return MoveResult::OUT_OF_MOVES;
 	}
 	
 	if (moves.size() == 1) {
 		*move = moves[0];
-		return MoveResult::MOVE_OK;
 	}
+	else if (isPonderHit && m_isPonderCompleted) {
+		*move = m_ponderMove;
+		m_isLastMovePonderHit = true;
+		if (m_printEval) {
+			std::cout << "Ponder hit" << '\n';
+		}
+	}
+	else {
+		if (m_moveTime.count() > 0) {
+			m_minMaxTree.setDeadline(std::chrono::steady_clock::now() + m_moveTime);
+		}
+		// Without a completed iteration the first generated move is all there is
+		const bool isSearched = searchPosition(board, moves, m_printEval);
+		m_minMaxTree.clearDeadline();
+		m_minMaxTree.clearStop();
+		*move = moves[0];
+		if (isSearched) {
+			findForcedMate(board, move);
+		}
+	}
+
+	if (m_ponder) {
+		startPondering(board, *move);
+	}
+	return MoveResult::MOVE_OK;
+}
+
+template <typename Evaluator>
+std::vector<SearchLine> MinMaxAiPlayer<Evaluator>::analyze(const ChessBoard& board) {
+	assert(board.getNextPlayerColor() == m_color);
+	stopPondering();
+	MovesVector moves;
+	board.getMoves(m_color, moves);
+	if (moves.empty() || !searchPosition(board, moves, m_printEval)) {
+		return { };
+	}
+	return m_searchLines;
+}
 
-	uint8_t bestMoveIndex = 0;
-	int16_t eval = m_color == WHITE ? CHESS_BOARD_MIN_EVALUATION : CHESS_BOARD_MAX_EVALUATION;
-	MinMaxTree minMaxTree;
-	for (uint i = 0; i < moves.size(); ++i) {
+template <typename Evaluator>
+bool MinMaxAiPlayer<Evaluator>::searchPosition(const ChessBoard& board, MovesVector& moves, bool verbose) {
+	m_failLows = 0;
+	m_failHighs = 0;
+	m_mtdfPasses = 0;
+	m_minMaxTree.newSearch();
+	std::array<int16_t, MAX_MOVES> moveEvals;
+	moveEvals.fill(0);
+	std::array<PrincipalVariation, MAX_MOVES> moveLines;
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> iterationNodes;
+	uint64_t previousNodes = 0;
+
+	// Iterative deepening, every iteration gives the aspiration window or the MTD(f) guess and the root move order of the next one.
+	// A stopped iteration is thrown away, the root moves are only reordered after a completed one so moves keeps its order
+	int16_t eval = 0;
+	uint8_t completedDepth = 0;
+	int16_t completedEval = 0;
+	std::array<int16_t, MAX_MOVES> completedEvals;
+	std::array<PrincipalVariation, MAX_MOVES> completedLines;
+	for (uint8_t depth = 1; depth <= m_searchDepth; ++depth) {
+		eval = m_rootSearch == RootSearch::MTDF && m_multiPV == 1 && depth > 1
+			? searchRootWithMtdf(m_minMaxTree, board, moves, moveEvals, moveLines, depth, eval)
+			: searchRootWithAspiration(m_minMaxTree, board, moves, moveEvals, moveLines, depth, eval);
+		if (m_minMaxTree.isStopped()) {
+			if (completedDepth == 0) {
+				return false;
+			}
+			eval = completedEval;
+			moveEvals = completedEvals;
+			moveLines = std::move(completedLines);
+			break;
+		}
+		const uint64_t nodes = m_minMaxTree.getStats().nodes;
+		iterationNodes.push_back(nodes - previousNodes);
+		previousNodes = nodes;
+
+		for (uint32_t i = 1; i < moves.size(); ++i) {
+			for (uint32_t j = i; j > 0 && moveEvals[j] > moveEvals[j - 1]; --j) {
+				std::swap(moves[j], moves[j - 1]);
+				std::swap(moveEvals[j], moveEvals[j - 1]);
+				std::swap(moveLines[j], moveLines[j - 1]);
+			}
+		}
+		completedDepth = depth;
+		completedEval = eval;
+		if (depth < m_searchDepth) {
+			completedEvals = moveEvals;
+			completedLines = moveLines;
+		}
+	}
+
+	SearchStats stats = m_minMaxTree.getStats();
+	stats.depth = completedDepth;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stats.iterationNodes = std::move(iterationNodes);
+
+	const int16_t colorSign = m_color == WHITE ? 1 : -1;
+	const uint32_t lines = std::min<uint32_t>(m_multiPV, moves.size());
+	std::vector<SearchLine> searchLines;
+	for (uint32_t i = 0; i < lines; ++i) {
+		searchLines.push_back({ static_cast<int16_t>(colorSign * moveEvals[i]), std::move(moveLines[i]) });
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_resultMutex);
+		m_searchStats = stats;
+		m_searchLines = searchLines;
+	}
+
+	if (verbose) {
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			board.printMoveOnBoard(moves[i]);
+			// Only the kept lines have an exact evaluation, the rest failed low against them
+			std::cout << " -> Eval: " << (i < lines ? "" : m_color == WHITE ? "<= " : ">= ") << colorSign * moveEvals[i] << '\n';
+		}
+	}
+
+	if (verbose) {
+		for (uint32_t i = 0; i < lines; ++i) {
+			std::cout << "Line " << (i + 1) << ": " << searchLines[i].evaluation << " ->";
+			for (const BoardMove move : searchLines[i].moves) {
+				std::cout << ' ' << move.toString();
+			}
+			std::cout << '\n';
+		}
+		std::cout << "Evaluation: " << colorSign * eval << '\n';
+		if (m_rootSearch == RootSearch::MTDF) {
+			std::cout << "MTD(f) passes: " << m_mtdfPasses << '\n';
+		}
+		else {
+			std::cout << "Aspiration fails: " << m_failLows << " low, " << m_failHighs << " high" << '\n';
+		}
+		stats.print(std::cout);
+	}
+	return true;
+}
+
+template <typename Evaluator>
+bool MinMaxAiPlayer<Evaluator>::findForcedMate(const ChessBoard& board, BoardMove* move) {
+	// Mate scores are not told apart by length, so even a mate the search already sees may never get closer.
+	// The solver only runs once the search has found a mate for the player
+	const int16_t colorSign = m_color == WHITE ? 1 : -1;
+	if (m_mateSolverNodes == 0 || m_searchLines.empty() || colorSign * m_searchLines[0].evaluation < CHESS_BOARD_MAX_EVALUATION) {
+		return false;
+	}
+
+	// A search line that ends in a mate is the mate to beat, its move is kept unless the solver proves a shorter one
+	uint32_t shortestMate = 0;
+	ChessBoard position(board);
+	for (uint32_t ply = 0; ply < m_searchLines[0].moves.size(); ++ply) {
+		position.playMove(m_searchLines[0].moves[ply]);
+		MovesVector replies;
+		position.getNextPlayerMoves(replies);
+		if (replies.empty()) {
+			shortestMate = ply % 2 == 0 && position.isKingInCheck(position.getNextPlayerColor()) ? ply / 2 + 1 : 0;
+			break;
+		}
+	}
+
+	if (!m_mateSolver) {
+		m_mateSolver = std::make_unique<MateSolver>(MATE_ATTACK_TABLE_MB);
+	}
+
+	// The solver proves a mate, not the shortest one, so every solve after a mate looks for a shorter one
+	bool isReplaced = false;
+	uint64_t nodesLeft = m_mateSolverNodes;
+	while (nodesLeft > 0 && shortestMate != 1) {
+		const MateResult result = m_mateSolver->solve(board, shortestMate == 0 ? 0 : shortestMate - 1, nodesLeft);
+		nodesLeft -= std::min(nodesLeft, result.nodes);
+		if (m_printEval) {
+			std::cout << "Mate solver: " << (result.status == MateStatus::MATE ? "mate in " + std::to_string(result.mateInMoves)
+				: result.status == MateStatus::NO_MATE ? (shortestMate == 0 ? "no mate" : "no shorter mate") : "unknown") << " after " << result.nodes << " nodes" << '\n';
+		}
+		if (result.status != MateStatus::MATE || result.moves.empty()) {
+			break;
+		}
+		shortestMate = result.mateInMoves;
+		*move = result.moves[0];
+		isReplaced = true;
+	}
+	return isReplaced;
+}
+
+template <typename Evaluator>
+void MinMaxAiPlayer<Evaluator>::startPondering(const ChessBoard& board, const BoardMove move) {
+	assert(!m_ponderThread.joinable());
+	ChessBoard afterMove(board);
+	afterMove.playMove(move);
+
+	// The expected reply is the best move the search stored for the position after our move
+	const BoardMove expectedReply = m_minMaxTree.getMemoBestMove(afterMove);
+	MovesVector replies;
+	afterMove.getNextPlayerMoves(replies);
+	if (!expectedReply.isValid() || std::find(replies.begin(), replies.end(), expectedReply) == replies.end()) {
+		return;
+	}
+
+	m_ponderPosition = afterMove;
+	m_ponderPosition.playMove(expectedReply);
+	m_expectedReply = expectedReply;
+	m_isPonderCompleted = false;
+	m_minMaxTree.clearStop();
+	m_ponderThread = std::thread([this]() {
+		MovesVector moves;
+		m_ponderPosition.getMoves(m_color, moves);
+		if (moves.size() > 1 && searchPosition(m_ponderPosition, moves, false)) {
+			m_ponderMove = moves[0];
+			m_isPonderCompleted = true;
+		}
+	});
+}
+
+template <typename Evaluator>
+void MinMaxAiPlayer<Evaluator>::stopPondering() {
+	if (!m_ponderThread.joinable()) {
+		return;
+	}
+	m_minMaxTree.requestStop();
+	m_ponderThread.join();
+	m_minMaxTree.clearStop();
+}
+
+template <typename Evaluator>
+int16_t MinMaxAiPlayer<Evaluator>::searchRoot(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t alpha, int16_t beta) const {
+	// Evaluations here are from the point of view of this player, the tree works from white's point of view.
+	// keptEvals holds the best m_multiPV evaluations so far, best first, a move has to beat the worst of them to be exact
+	std::vector<int16_t> keptEvals;
+	int16_t eval = CHESS_BOARD_MIN_EVALUATION;
+	for (uint32_t i = 0; i < moves.size(); ++i) {
 		ChessBoard b(board);
 		b.playMove(moves[i]);
-		const int16_t positionEval = minMaxTree.expand(b, 7);
+		const int16_t moveAlpha = keptEvals.size() < m_multiPV ? alpha : std::max(alpha, keptEvals.back());
+		moveEvals[i] = m_color == WHITE
+			? minMaxTree.expand(b, depth - 1, moveAlpha, beta)
+			: -minMaxTree.expand(b, depth - 1, -beta, -moveAlpha);
 
-		b.printMoveOnBoard(moves[i]);
-		std::cout << " -> Eval: " << positionEval << '\n';
+		moveLines[i].clear();
+		if (moveEvals[i] > moveAlpha) {
+			moveLines[i].push_back(moves[i]);
+			const PrincipalVariation line = minMaxTree.getPrincipalVariation(b);
+			moveLines[i].insert(moveLines[i].end(), line.begin(), line.end());
+			keptEvals.insert(std::upper_bound(keptEvals.begin(), keptEvals.end(), moveEvals[i], std::greater<int16_t>()), moveEvals[i]);
+			if (keptEvals.size() > m_multiPV) {
+				keptEvals.pop_back();
+			}
+		}
 
-		if ((m_color == WHITE && positionEval > eval) || (m_color == BLACK && positionEval < eval)) {
-			bestMoveIndex = i;
-			eval = positionEval;
+		eval = std::max(eval, moveEvals[i]);
+		if (keptEvals.size() >= m_multiPV && keptEvals.back() >= beta) {
+			// The moves after the cutoff were not searched, they must not keep evaluations from older searches
+			for (uint32_t j = i + 1; j < moves.size(); ++j) {
+				moveEvals[j] = CHESS_BOARD_MIN_EVALUATION;
+				moveLines[j].clear();
+			}
+			break;
 		}
 	}
+	return eval;
+}
 
-	/*
-	auto runEval = [&moves, &board, &bestMoveIndex, &eval, &getBetterEvalAndSwapIndices, this]() {
-		MinMaxTreeChessBoard minMaxTree;
-		uint8_t localBestMoveIndex = 0;
-		ChessBoardEvalType localEval = m_color == WHITE ? CHESS_BOARD_MIN_EVALUATION : CHESS_BOARD_MAX_EVALUATION;
-		while (m_nextMoveIndexAtomic < moves.size()) {
-			uint8_t localNextMoveIndex = m_nextMoveIndexAtomic++;
-			ChessBoard b(board);
-			b.playMove(moves[localNextMoveIndex]);
-			localEval = getBetterEvalAndSwapIndices(m_color, minMaxTree.expand(b, 5), localEval, &localNextMoveIndex, &localBestMoveIndex);
-		}
-		std::lock_guard<std::mutex> lock(m_evalMutex);
-		eval = getBetterEvalAndSwapIndices(m_color, localEval, eval, &localBestMoveIndex, &bestMoveIndex);
+template <typename Evaluator>
+int16_t MinMaxAiPlayer<Evaluator>::searchRootWithAspiration(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t previousEval) {
+	// The window is built around the best line, the other lines of a multi pv search could fall below it
+	if (!m_aspirationOptions.enabled || depth == 1 || m_multiPV > 1) {
+		return searchRoot(minMaxTree, board, moves, moveEvals, moveLines, depth, CHESS_BOARD_MIN_EVALUATION, CHESS_BOARD_MAX_EVALUATION);
+	}
+
+	const auto clampEval = [](int32_t eval) {
+		return static_cast<int16_t>(std::clamp<int32_t>(eval, CHESS_BOARD_MIN_EVALUATION, CHESS_BOARD_MAX_EVALUATION));
 	};
 
-	std::vector<std::thread> threads;
-	threads.reserve(m_numOfThreads);
-	for (uint i = 0; i < m_numOfThreads; ++i) {
-		threads.emplace_back(runEval);
+	float window = m_aspirationOptions.initialWindow;
+	int16_t alpha = clampEval(previousEval - window);
+	int16_t beta = clampEval(previousEval + window);
+	for (uint32_t fails = 0; ; ++fails) {
+		if (fails >= m_aspirationOptions.maxFailsBeforeFullWindow) {
+			alpha = CHESS_BOARD_MIN_EVALUATION;
+			beta = CHESS_BOARD_MAX_EVALUATION;
+		}
+
+		const int16_t eval = searchRoot(minMaxTree, board, moves, moveEvals, moveLines, depth, alpha, beta);
+		window *= m_aspirationOptions.growthFactor;
+		if (eval <= alpha && alpha > CHESS_BOARD_MIN_EVALUATION) {
+			m_failLows++;
+			alpha = clampEval(eval - window);
+		}
+		else if (eval >= beta && beta < CHESS_BOARD_MAX_EVALUATION) {
+			m_failHighs++;
+			beta = clampEval(eval + window);
+		}
+		else {
+			return eval;
+		}
 	}
+}
 
-	for (auto& t : threads) {
-		t.join();
+template <typename Evaluator>
+int16_t MinMaxAiPlayer<Evaluator>::searchRootWithMtdf(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t firstGuess) {
+	// Every zero window search moves one of the bounds to its result, they meet at the evaluation of the position.
+	// The memo keeps the bounds of the previous passes so the later ones are cheap
+	int16_t lowerBound = CHESS_BOARD_MIN_EVALUATION;
+	int16_t upperBound = CHESS_BOARD_MAX_EVALUATION;
+	int16_t eval = firstGuess;
+	uint32_t bestIndex = 0;
+	PrincipalVariation bestLine;
+	while (lowerBound < upperBound) {
+		const int16_t beta = std::max<int16_t>(eval, lowerBound + 1);
+		eval = searchRoot(minMaxTree, board, moves, moveEvals, moveLines, depth, beta - 1, beta);
+		m_mtdfPasses++;
+		if (minMaxTree.isStopped()) {
+			return eval;
+		}
+
+		if (eval < beta) {
+			upperBound = eval;
+		}
+		else {
+			// Only the move that failed high has an evaluation of at least beta, the search stopped on it
+			lowerBound = eval;
+			bestIndex = std::max_element(moveEvals.begin(), moveEvals.begin() + moves.size()) - moveEvals.begin();
+			bestLine = moveLines[bestIndex];
+		}
 	}
-	*/
 
-	*move = moves[bestMoveIndex];
-	if (m_printEval) {
-		std::cout << "Evaluation: " << eval << '\n';
+	// The last pass may have failed low, only keep the order: the best move first, the rest below it
+	for (uint32_t i = 0; i < moves.size(); ++i) {
+		moveEvals[i] = i == bestIndex ? eval : std::min<int16_t>(moveEvals[i], eval - 1);
 	}
-	return MoveResult::MOVE_OK;
+	if (!bestLine.empty()) {
+		moveLines[bestIndex] = std::move(bestLine);
+	}
+	return eval;
 }
+
+template class MinMaxAiPlayer<MaterialEvaluator>;
+template class MinMaxAiPlayer<PieceSquareEvaluator>;
+template class MinMaxAiPlayer<PawnStructureEvaluator>;
+template class MinMaxAiPlayer<NNAIEvaluator>;
@@ -1,29 +1,198 @@
 #pragma once
 
-class MinMaxAiPlayer;
+template <typename Evaluator> class MinMaxAiPlayer;
 
 #include "game/player.h"
 #include "min-max-ai/min-max-tree.h"
 #include "min-max-ai/chess-board-evaluator.hpp"
-#include "tools/random-generator.h"
+#include "min-max-ai/mate-solver.hpp"
 
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
 
+// The root is searched with a narrow window around the score of the previous iteration.
+// When the score falls outside, the failed side of the window grows by growthFactor and the search is repeated
+struct AspirationOptions {
+	bool enabled = true;
+	int16_t initialWindow = 25;
+	float growthFactor = 2.0f;
+	uint32_t maxFailsBeforeFullWindow = 4;
+};
+
+enum class RootSearch {
+	ALPHA_BETA, // every iteration searches the root with an aspiration window, see AspirationOptions
+	MTDF, // every iteration runs zero window searches until the evaluation is found, only with a single pv
+};
+
+// A root move with its evaluation from white's point of view and the line the search expects after it
+struct SearchLine {
+	int16_t evaluation;
+	PrincipalVariation moves;
+};
+
+// Evaluator is the policy of the search tree. The policies in chess-board-evaluator.hpp, pawn-structure.hpp
+// and NNAIEvaluator are compiled in min-max-ai-player.cpp, any other policy has to be added there
+template <typename Evaluator = PawnStructureEvaluator>
 class MinMaxAiPlayer : public Player {
 public:
-	MinMaxAiPlayer(Color color, bool printEval, bool randomPadding, uint32_t numOfThreads)
+	MinMaxAiPlayer(Color color, bool printEval)
+	requires std::is_default_constructible_v<Evaluator>
+		: MinMaxAiPlayer(color, printEval, Evaluator()) { }
+
+	MinMaxAiPlayer(Color color, bool printEval, const Evaluator& evaluator)
 		: Player(color)
+		, m_minMaxTree(SearchOptions(), evaluator)
 		, m_printEval(printEval)
-		, m_useRandomPadding(randomPadding)
-		, m_numOfThreads(numOfThreads) { }
+		, m_failLows(0)
+		, m_failHighs(0)
+		, m_multiPV(1)
+		, m_rootSearch(RootSearch::ALPHA_BETA)
+		, m_mtdfPasses(0)
+		, m_mateSolverNodes(0)
+		, m_searchDepth(SEARCH_DEPTH)
+		, m_moveTime(0)
+		, m_ponder(false)
+		, m_expectedReply(INVALID_MOVE)
+		, m_ponderMove(INVALID_MOVE)
+		, m_isPonderCompleted(false) { }
+
+	~MinMaxAiPlayer() {
+		stopPondering();
+	}
 
 	MoveResult getMove(const ChessBoard& board, BoardMove* move);
 
+	// Searches the position to the search depth without playing a move, returns the best lines of the search
+	std::vector<SearchLine> analyze(const ChessBoard& board);
+
+	void revert() override {
+		stopPondering();
+	}
+
+	// After every move, keep searching the position after the expected reply on a background thread.
+	// When the reply is played the move comes from that search, it gets the move time from then on to finish.
+	// Every setter below stops a running ponder search first
+	inline void setPondering(bool ponder) {
+		m_ponder = ponder;
+		if (!m_ponder) {
+			stopPondering();
+		}
+	}
+
+	inline void setSearchOptions(const SearchOptions& options) {
+		stopPondering();
+		m_minMaxTree.setSearchOptions(options);
+	}
+
+	inline void setAspirationOptions(const AspirationOptions& options) {
+		stopPondering();
+		m_aspirationOptions = options;
+	}
+
+	inline void setRootSearch(RootSearch rootSearch) {
+		stopPondering();
+		m_rootSearch = rootSearch;
+	}
+
+	// Number of root moves that get an exact evaluation and a line, they all come from one search.
+	// Every root move after the first is searched with the evaluation of the last kept line as alpha
+	inline void setMultiPV(uint32_t lines) {
+		stopPondering();
+		m_multiPV = std::max<uint32_t>(lines, 1);
+	}
+
+	// Node budget of the mate solver that runs after a search finds a forced mate, it looks for a shorter one.
+	// 0 turns it off, it is off until this is called
+	inline void setMateSolverNodes(uint64_t nodes) {
+		stopPondering();
+		m_mateSolverNodes = nodes;
+	}
+
+	// Size of the memo of the search tree, DEFAULT_TRANSPOSITION_TABLE_MB if it is never set. The memo is emptied
+	inline void setMemoSize(size_t sizeInMB) {
+		stopPondering();
+		m_minMaxTree.setMemoSize(sizeInMB);
+	}
+
+	// Empties the tables of the search tree, the next search does not use anything from the previous ones
+	inline void clearTables() {
+		stopPondering();
+		m_minMaxTree.clearTables();
+	}
+
+	// Depth of the last iteration of every search
+	inline void setSearchDepth(uint8_t depth) {
+		stopPondering();
+		m_searchDepth = std::max<uint8_t>(depth, 1);
+	}
+
+	// Time getMove has for a move, the move comes from the last iteration that finished in time. 0 searches to the full depth
+	inline void setMoveTime(std::chrono::milliseconds moveTime) {
+		stopPondering();
+		m_moveTime = moveTime;
+	}
+
+	// Reply the running ponder search expects, INVALID_MOVE when nothing is pondered
+	inline BoardMove getExpectedReply() const {
+		return m_ponderThread.joinable() ? m_expectedReply : INVALID_MOVE;
+	}
+
+	// True if the move of the last getMove came from the ponder search
+	inline bool isLastMovePonderHit() const {
+		return m_isLastMovePonderHit;
+	}
+
+	// Best lines of the last completed search, best first. Safe while a ponder search runs
+	inline std::vector<SearchLine> getSearchLines() const {
+		std::lock_guard<std::mutex> lock(m_resultMutex);
+		return m_searchLines;
+	}
+
+	// Statistics of the last completed search, pondering searches included. Safe while a ponder search runs
+	inline SearchStats getSearchStats() const {
+		std::lock_guard<std::mutex> lock(m_resultMutex);
+		return m_searchStats;
+	}
+
 private:
+	static constexpr uint8_t SEARCH_DEPTH = 7;
+	static constexpr size_t MATE_ATTACK_TABLE_MB = 4;
+
+	MinMaxTree<Evaluator> m_minMaxTree; // kept for the whole game so every search starts from the tables of the previous one
+	AspirationOptions m_aspirationOptions;
 	bool m_printEval;
-	bool m_useRandomPadding;
-	uint32_t m_numOfThreads;
-	RandomGenerator m_rgen;
-	std::mutex m_evalMutex;
-	std::atomic<uint8_t> m_nextMoveIndexAtomic;
+	uint32_t m_failLows;
+	uint32_t m_failHighs;
+	SearchStats m_searchStats;
+	uint32_t m_multiPV;
+	RootSearch m_rootSearch;
+	uint32_t m_mtdfPasses;
+	uint64_t m_mateSolverNodes;
+	std::unique_ptr<MateSolver> m_mateSolver; // only allocated once a mating attack comes up
+	uint8_t m_searchDepth;
+	std::vector<SearchLine> m_searchLines;
+	mutable std::mutex m_resultMutex; // m_searchStats and m_searchLines are written by the ponder thread
+	std::chrono::milliseconds m_moveTime;
+	bool m_ponder;
+	std::thread m_ponderThread;
+	ChessBoard m_ponderPosition;
+	BoardMove m_expectedReply;
+	BoardMove m_ponderMove;
+	bool m_isPonderCompleted;
+	bool m_isLastMovePonderHit;
+
+	bool searchPosition(const ChessBoard& board, MovesVector& moves, bool verbose);
+	void startPondering(const ChessBoard& board, const BoardMove move);
+	void stopPondering();
+	bool findForcedMate(const ChessBoard& board, BoardMove* move);
+
+	int16_t searchRoot(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t alpha, int16_t beta) const;
+	int16_t searchRootWithAspiration(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t previousEval);
+	int16_t searchRootWithMtdf(MinMaxTree<Evaluator>& minMaxTree, const ChessBoard& board, MovesVector& moves, std::array<int16_t, MAX_MOVES>& moveEvals,
+		std::array<PrincipalVariation, MAX_MOVES>& moveLines, uint8_t depth, int16_t firstGuess);
 };
@@ -1,85 +1,400 @@
 #pragma once
 
-class MinMaxTree;
+template <typename Evaluator> class MinMaxTree;
 
 #include "game/chess-board.h"
 #include "min-max-ai/chess-board-evaluator.hpp"
+#include "min-max-ai/evaluation-cache.hpp"
+#include "min-max-ai/move-ordering.hpp"
+#include "min-max-ai/pawn-structure.hpp"
+#include "min-max-ai/search-stats.hpp"
+#include "min-max-ai/transposition-table.h"
 
-#include "unordered_dense.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
 
+typedef std::vector<BoardMove> PrincipalVariation;
+
+// Every pruning technique can be turned off to measure its node reduction and strength impact
+struct SearchOptions {
+	bool useQuiescence = true; // resolve captures at the leaves instead of using the static evaluation
+	bool useNullMove = true;
+	bool useReverseFutility = true;
+	bool useRazoring = true;
+	bool useLateMoveReductions = true;
+};
+
+// Depth reductions for late quiet moves, indexed by [depth][move index]
+class LateMoveReductions {
+public:
+	LateMoveReductions() {
+		for (uint32_t depth = 0; depth < TABLE_SIZE; ++depth) {
+			for (uint32_t moveIndex = 0; moveIndex < TABLE_SIZE; ++moveIndex) {
+				const float reduction = depth == 0 || moveIndex == 0 ? 0.0f
+					: 0.75f + std::log(static_cast<float>(depth)) * std::log(static_cast<float>(moveIndex)) / 2.25f;
+				m_reductions[depth][moveIndex] = static_cast<uint8_t>(reduction);
+			}
+		}
+	}
+
+	constexpr uint8_t get(const uint8_t depth, const uint32_t moveIndex) const {
+		return m_reductions[std::min<uint32_t>(depth, TABLE_SIZE - 1)][std::min<uint32_t>(moveIndex, TABLE_SIZE - 1)];
+	}
+
+private:
+	static constexpr uint32_t TABLE_SIZE = 64;
+	std::array<std::array<uint8_t, TABLE_SIZE>, TABLE_SIZE> m_reductions;
+};
+
+static const LateMoveReductions LATE_MOVE_REDUCTIONS;
+
+// Evaluator is one of the policies in chess-board-evaluator.hpp and pawn-structure.hpp or any type with the same evaluate method
+template <typename Evaluator = PawnStructureEvaluator>
 class MinMaxTree {
 public:
-	union EvalDepth {
-		struct {
-			int16_t evaluation;
-			uint8_t depth;
-		};
-		uint64_t evalDepth;
-	};
+	MinMaxTree() : MinMaxTree(SearchOptions()) { }
+	MinMaxTree(const SearchOptions& options) : MinMaxTree(options, Evaluator()) { }
+	MinMaxTree(const SearchOptions& options, const Evaluator& evaluator)
+			: m_options(options)
+			, m_evaluator(evaluator)
+			, m_stopRequested(false)
+			, m_deadline(NO_DEADLINE) {
+		m_pvLength.fill(0);
+	}
+
+	inline void setSearchOptions(const SearchOptions& options) {
+		m_options = options;
+	}
+
+	// Can be called from another thread, the running expand returns as soon as possible with a meaningless evaluation.
+	// Nothing from the stopped search is stored so the tables stay valid
+	inline void requestStop() {
+		m_stopRequested.store(true, std::memory_order_relaxed);
+	}
+
+	inline void clearStop() {
+		m_stopRequested.store(false, std::memory_order_relaxed);
+	}
+
+	inline bool isStopped() const {
+		return m_stopRequested.load(std::memory_order_relaxed);
+	}
+
+	// The search stops itself like with requestStop once the deadline passes, can be set from another thread
+	inline void setDeadline(const std::chrono::steady_clock::time_point deadline) {
+		m_deadline.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+	}
 
-	typedef ankerl::unordered_dense::map<uint64_t, EvalDepth> MinMaxMemoMap;
+	inline void clearDeadline() {
+		m_deadline.store(NO_DEADLINE, std::memory_order_relaxed);
+	}
+
+	// Best move stored for the position by previous searches, INVALID_MOVE if there is none
+	inline BoardMove getMemoBestMove(const ChessBoard& position) const {
+		const TranspositionEntry* entry = m_memo.probe(position.getHash());
+		return entry ? entry->bestMove : INVALID_MOVE;
+	}
 
-	MinMaxTree()
-			: m_minEval(CHESS_BOARD_MAX_EVALUATION)
-			, m_maxEval(CHESS_BOARD_MIN_EVALUATION) { }
+	// Drops everything the previous searches stored, for a search that has nothing to do with them
+	inline void clearTables() {
+		m_memo.clear();
+		m_evaluationCache.clear();
+		m_moveOrdering.clear();
+	}
+
+	// Replaces the memo with an empty one of sizeInMB
+	inline void setMemoSize(const size_t sizeInMB) {
+		m_memo = TranspositionTable(sizeInMB);
+	}
+
+	// The memo and the move ordering tables are kept between searches,
+	// this only ages them so the new search can replace what is no longer useful
+	inline void newSearch() {
+		m_memo.newSearch();
+		m_moveOrdering.newSearch();
+		m_stats = SearchStats();
+	}
 
+	// Returns the evaluation of the position from white's point of view
 	inline int16_t expand(const ChessBoard& rootPosition, uint8_t depth) {
-		const auto expandFromInner = [this](const ChessBoard& currentPosition, uint8_t currentDepth, const auto recFunc) {
-			auto it = m_memo.find(currentPosition.getHash());
-			if (it != m_memo.end() && it->second.depth >= currentDepth) {
-				return it->second.evaluation;
-			}
+		return expand(rootPosition, depth, CHESS_BOARD_MIN_EVALUATION, CHESS_BOARD_MAX_EVALUATION);
+	}
+
+	// Searches inside the (alpha, beta) window, both the window and the result are from white's point of view.
+	// If the result is outside the window it is only a bound of the real evaluation
+	inline int16_t expand(const ChessBoard& rootPosition, uint8_t depth, int16_t alpha, int16_t beta) {
+		if (rootPosition.getNextPlayerColor() == WHITE) {
+			return search(rootPosition, depth, 0, alpha, beta, INVALID_MOVE, true);
+		}
+		return -search(rootPosition, depth, 0, -beta, -alpha, INVALID_MOVE, true);
+	}
+
+	// Line of the last expand, starting from its root position. The line collected during the search is cut short
+	// where the memo answered a position, so it is continued with the best moves stored in the memo
+	PrincipalVariation getPrincipalVariation(const ChessBoard& rootPosition) const {
+		PrincipalVariation line(m_pvTable[0].begin(), m_pvTable[0].begin() + m_pvLength[0]);
+		ChessBoard position(rootPosition);
+		for (const BoardMove move : line) {
+			position.playMove(move);
+		}
 
-			Color nextPlayerColor = currentPosition.getNextPlayerColor();
+		while (line.size() < MAX_PRINCIPAL_VARIATION_LENGTH) {
+			const BoardMove move = getMemoBestMove(position);
 			MovesVector moves;
-			currentPosition.getMoves(nextPlayerColor, moves);
-
-			if (currentDepth == 0 || moves.empty()) {
-				EvalDepth evalDepth;
-				evalDepth.evaluation = evaluate(currentPosition, moves);
-				evalDepth.depth = 0;
-				m_memo[currentPosition.getHash()] = evalDepth;
-				return evalDepth.evaluation;
+			position.getNextPlayerMoves(moves);
+			if (!move.isValid() || std::find(moves.begin(), moves.end(), move) == moves.end()) {
+				break;
 			}
-			
-			int16_t eval = nextPlayerColor == WHITE ? CHESS_BOARD_MIN_EVALUATION : CHESS_BOARD_MAX_EVALUATION;
-			if (nextPlayerColor == WHITE) {
-				for (const auto& m : moves) {
-					ChessBoard b(currentPosition);
-					b.playMove(m);
-					const int16_t newEval = recFunc(b, currentDepth - 1, recFunc);
-					eval = std::max(eval, newEval);
-					if (eval > m_minEval) {
-						break;
-					}
-					m_maxEval = std::max(m_maxEval, eval);
+			line.push_back(move);
+			position.playMove(move);
+		}
+		return line;
+	}
+
+	// Counters since the last newSearch, the caller fills the depth, timing and per iteration fields
+	inline SearchStats getStats() const {
+		SearchStats stats = m_stats;
+		stats.memoHashfull = m_memo.getHashfull();
+		return stats;
+	}
+
+private:
+	static constexpr uint8_t NULL_MOVE_MIN_DEPTH = 3;
+	static constexpr uint8_t NULL_MOVE_REDUCTION = 2;
+	static constexpr uint8_t REVERSE_FUTILITY_MAX_DEPTH = 3;
+	static constexpr int16_t REVERSE_FUTILITY_MARGIN = 15; // per depth, a pawn is 10
+	static constexpr uint8_t RAZORING_MAX_DEPTH = 2;
+	static constexpr int16_t RAZORING_MARGIN = 30; // per depth
+	static constexpr uint8_t LATE_MOVE_MIN_DEPTH = 3;
+	static constexpr uint32_t LATE_MOVE_MIN_INDEX = 3;
+	static constexpr uint32_t MAX_PRINCIPAL_VARIATION_LENGTH = 32; // the memo can loop through repeated positions
+	static constexpr uint64_t DEADLINE_CHECK_MASK = 1023;
+	static constexpr std::chrono::steady_clock::rep NO_DEADLINE = std::numeric_limits<std::chrono::steady_clock::rep>::max();
+
+	SearchOptions m_options;
+	Evaluator m_evaluator;
+	std::atomic<bool> m_stopRequested;
+	std::atomic<std::chrono::steady_clock::rep> m_deadline;
+	TranspositionTable m_memo;
+	EvaluationCache m_evaluationCache; // the tree belongs to one search thread, so the cache is per thread
+	MoveOrdering m_moveOrdering;
+	SearchStats m_stats;
+	std::array<std::array<BoardMove, MAX_SEARCH_PLY>, MAX_SEARCH_PLY> m_pvTable; // [ply] holds the best line from ply onwards
+	std::array<uint32_t, MAX_SEARCH_PLY> m_pvLength;
+
+	// Negamax alpha-beta, evaluations are from the point of view of the player to move, the memo keeps them the same way
+	int16_t search(const ChessBoard& position, const uint8_t depth, const uint32_t ply,
+			int16_t alpha, const int16_t beta, const BoardMove previousMove, const bool allowNullMove) {
+		if (isStopped()) {
+			return 0;
+		}
+
+		m_stats.nodes++;
+		checkDeadline();
+		m_stats.selectiveDepth = std::max(m_stats.selectiveDepth, ply);
+		m_pvLength[ply] = ply;
+		const Color nextPlayerColor = position.getNextPlayerColor();
+		const int16_t colorSign = nextPlayerColor == WHITE ? 1 : -1;
+
+		BoardMove hashMove = INVALID_MOVE;
+		m_stats.memoProbes++;
+		const TranspositionEntry* entry = m_memo.probe(position.getHash());
+		if (entry) {
+			m_stats.memoHits++;
+			if (entry->isUsable(depth, alpha, beta)) {
+				return entry->evaluation;
+			}
+			hashMove = entry->bestMove;
+		}
+
+		MovesVector moves;
+		position.getMoves(nextPlayerColor, moves);
+
+		if (depth == 0 && m_options.useQuiescence && !moves.empty()) {
+			return quiescence(position, moves, ply, alpha, beta);
+		}
+
+		if (depth == 0 || moves.empty()) {
+			const int16_t evaluation = colorSign * staticEvaluation(position, moves);
+			storeInMemo(position.getHash(), evaluation, 0, BOUND_EXACT, INVALID_MOVE);
+			return evaluation;
+		}
+
+		const bool isInCheck = position.isKingInCheck(nextPlayerColor);
+		if (!isInCheck) {
+			const int16_t staticEval = colorSign * staticEvaluation(position, moves);
+
+			// Reverse futility: we are so far above beta that a quiet move near the leaves won't bring us back
+			const int16_t futilityMargin = REVERSE_FUTILITY_MARGIN * depth;
+			if (m_options.useReverseFutility && depth <= REVERSE_FUTILITY_MAX_DEPTH
+				&& !isMateEvaluation(beta) && staticEval - futilityMargin >= beta) {
+				return staticEval - futilityMargin;
+			}
+
+			// Razoring: we are so far below alpha that only captures can save us, check them with quiescence
+			if (m_options.useRazoring && m_options.useQuiescence && depth <= RAZORING_MAX_DEPTH
+				&& staticEval + RAZORING_MARGIN * depth < alpha) {
+				const int16_t razorEval = quiescence(position, moves, ply, alpha, beta);
+				if (razorEval < alpha) {
+					return razorEval;
 				}
 			}
-			else {
-				for (const auto& m : moves) {
-					ChessBoard b(currentPosition);
-					b.playMove(m);
-					const int16_t newEval = recFunc(b, currentDepth - 1, recFunc);
-					eval = std::min(eval, newEval);
-					if (eval < m_maxEval) {
-						break;
+
+			// Null move: if passing still fails high the position is good enough to cut.
+			// In king and pawn endings zugzwang is common, so a fail high is verified with a reduced search
+			if (m_options.useNullMove && allowNullMove && depth >= NULL_MOVE_MIN_DEPTH
+				&& staticEval >= beta && !isMateEvaluation(beta)) {
+				const uint8_t reducedDepth = depth - 1 - NULL_MOVE_REDUCTION - depth / 6;
+				ChessBoard b(position);
+				b.playNullMove();
+				const int16_t nullEval = -search(b, reducedDepth, ply + 1, -beta, -beta + 1, INVALID_MOVE, false);
+				if (nullEval >= beta) {
+					if (position.hasNonPawnMaterial(nextPlayerColor)
+						|| search(position, reducedDepth, ply, beta - 1, beta, previousMove, false) >= beta) {
+						return isMateEvaluation(nullEval) ? beta : nullEval;
 					}
-					m_minEval = std::min(m_minEval, eval);
 				}
 			}
+		}
 
-			EvalDepth evalDepth;
-			evalDepth.evaluation = eval;
-			evalDepth.depth = currentDepth;
-			m_memo[currentPosition.getHash()] = evalDepth;
-			return eval;
-		};
+		MoveScores scores;
+		m_moveOrdering.scoreMoves(position, moves, hashMove, previousMove, ply, scores);
+
+		m_pvLength[ply] = ply; // the null move verification searches this ply too
+		const int16_t originalAlpha = alpha;
+		int16_t eval = CHESS_BOARD_MIN_EVALUATION;
+		BoardMove bestMove = INVALID_MOVE;
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			MoveOrdering::pickNextMove(moves, scores, i);
+			const bool isQuiet = !position.isCapture(moves[i]) && moves[i].promotionType == EMPTY;
+			ChessBoard b(position);
+			b.playMove(moves[i]);
+
+			// Late quiet moves are searched with a reduced depth and a zero window first,
+			// only if one of them beats alpha it is searched again with the full depth
+			int16_t newEval = 0;
+			bool needsFullSearch = true;
+			if (m_options.useLateMoveReductions && depth >= LATE_MOVE_MIN_DEPTH && i >= LATE_MOVE_MIN_INDEX
+				&& isQuiet && !isInCheck && !b.isKingInCheck(b.getNextPlayerColor())) {
+				const uint8_t reduction = std::min<uint8_t>(LATE_MOVE_REDUCTIONS.get(depth, i), depth - 1);
+				if (reduction > 0) {
+					newEval = -search(b, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, moves[i], true);
+					needsFullSearch = newEval > alpha;
+				}
+			}
+
+			if (needsFullSearch) {
+				newEval = -search(b, depth - 1, ply + 1, -beta, -alpha, moves[i], true);
+			}
+
+			if (isStopped()) {
+				return 0;
+			}
 
-		return expandFromInner(rootPosition, depth, expandFromInner);
+			if (newEval > eval || !bestMove.isValid()) {
+				eval = newEval;
+				bestMove = moves[i];
+			}
+			if (newEval > alpha) {
+				updatePrincipalVariation(ply, moves[i]);
+			}
+			alpha = std::max(alpha, eval);
+			if (alpha >= beta) {
+				m_stats.cutoffs++;
+				m_stats.firstMoveCutoffs += i == 0;
+				m_moveOrdering.updateOnCutoff(position, moves, i, previousMove, ply, depth);
+				break;
+			}
+		}
+
+		const MemoBound bound = eval <= originalAlpha ? BOUND_UPPER : eval >= beta ? BOUND_LOWER : BOUND_EXACT;
+		storeInMemo(position.getHash(), eval, depth, bound, bestMove);
+		return eval;
 	}
 
-private:
-	MinMaxMemoMap m_memo;
-	int16_t m_minEval;
-	int16_t m_maxEval;
+	// White's point of view, shared by the main search and quiescence
+	inline int16_t staticEvaluation(const ChessBoard& position, const MovesVector& moves) {
+		if constexpr (!shouldCacheEvaluations<Evaluator>()) {
+			return m_evaluator.evaluate(position, moves);
+		}
+		else {
+			m_stats.evaluationCacheProbes++;
+			int16_t evaluation;
+			if (m_evaluationCache.probe(position.getHash(), evaluation)) {
+				m_stats.evaluationCacheHits++;
+				return evaluation;
+			}
+			evaluation = m_evaluator.evaluate(position, moves);
+			m_evaluationCache.store(position.getHash(), evaluation);
+			return evaluation;
+		}
+	}
+
+	// The clock is only read every few nodes, a passed deadline turns into a stop request
+	inline void checkDeadline() {
+		if ((m_stats.nodes & DEADLINE_CHECK_MASK) == 0
+				&& std::chrono::steady_clock::now().time_since_epoch().count() >= m_deadline.load(std::memory_order_relaxed)) {
+			requestStop();
+		}
+	}
+
+	inline void updatePrincipalVariation(const uint32_t ply, const BoardMove move) {
+		if (ply + 1 >= MAX_SEARCH_PLY) {
+			return;
+		}
+		m_pvTable[ply][ply] = move;
+		for (uint32_t i = ply + 1; i < m_pvLength[ply + 1]; ++i) {
+			m_pvTable[ply][i] = m_pvTable[ply + 1][i];
+		}
+		m_pvLength[ply] = std::max(m_pvLength[ply + 1], ply + 1);
+	}
+
+	inline void storeInMemo(const uint64_t hash, const int16_t evaluation, const uint8_t depth, const MemoBound bound, const BoardMove bestMove) {
+		m_stats.memoStores++;
+		m_stats.memoReplacements += m_memo.store(hash, evaluation, depth, bound, bestMove);
+	}
+
+	// Searches only captures and queen promotions until the position is quiet.
+	// The player to move can always stand pat with the static evaluation
+	int16_t quiescence(const ChessBoard& position, MovesVector& moves, const uint32_t ply, int16_t alpha, const int16_t beta) {
+		if (isStopped()) {
+			return 0;
+		}
+
+		m_stats.selectiveDepth = std::max(m_stats.selectiveDepth, ply);
+		const int16_t colorSign = position.getNextPlayerColor() == WHITE ? 1 : -1;
+		int16_t eval = colorSign * staticEvaluation(position, moves);
+		if (moves.empty() || eval >= beta || ply >= MAX_SEARCH_PLY) {
+			return eval;
+		}
+		alpha = std::max(alpha, eval);
+
+		MoveScores scores;
+		m_moveOrdering.scoreMoves(position, moves, INVALID_MOVE, INVALID_MOVE, ply, scores);
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			MoveOrdering::pickNextMove(moves, scores, i);
+			if (!position.isCapture(moves[i]) && moves[i].promotionType != QUEEN) {
+				break; // captures are scored above every quiet move, the rest are quiet
+			}
+
+			// The position quiescence starts from was already counted by search
+			m_stats.nodes++;
+			m_stats.quiescenceNodes++;
+			checkDeadline();
+			ChessBoard b(position);
+			b.playMove(moves[i]);
+			MovesVector nextMoves;
+			b.getMoves(b.getNextPlayerColor(), nextMoves);
+			eval = std::max(eval, static_cast<int16_t>(-quiescence(b, nextMoves, ply + 1, -beta, -alpha)));
+			alpha = std::max(alpha, eval);
+			if (alpha >= beta) {
+				break;
+			}
+		}
+		return eval;
+	}
 };
@@ -0,0 +1,144 @@
+#pragma once
+
+class MoveOrdering;
+
+#include "game/chess-board.h"
+
+#include <array>
+#include <algorithm>
+
+static constexpr uint32_t MAX_SEARCH_PLY = 128;
+static constexpr uint32_t KILLERS_PER_PLY = 2;
+
+typedef std::array<int32_t, MAX_MOVES> MoveScores;
+
+// Holds the move ordering heuristics of a single search thread.
+// Moves are searched in the order: hash move, captures (MVV-LVA), killers, countermove, quiets by history
+class MoveOrdering {
+public:
+	MoveOrdering() {
+		clear();
+	}
+
+	inline void clear() {
+		for (auto& killers : m_killers) {
+			killers.fill(INVALID_MOVE);
+		}
+		m_history.fill(0);
+		m_counterMoves.fill(INVALID_MOVE);
+	}
+
+	// Killers are relative to the root ply so they are dropped, history is halved so newer results weigh more
+	inline void newSearch() {
+		for (auto& killers : m_killers) {
+			killers.fill(INVALID_MOVE);
+		}
+		for (auto& entry : m_history) {
+			entry /= 2;
+		}
+	}
+
+	inline void scoreMoves(const ChessBoard& board, const MovesVector& moves, const BoardMove hashMove,
+			const BoardMove previousMove, const uint32_t ply, MoveScores& outScores) const {
+		const Color color = board.getNextPlayerColor();
+		const BoardMove counterMove = previousMove.isValid() ? m_counterMoves[counterMoveIndex(board, previousMove)] : INVALID_MOVE;
+		const auto& killers = m_killers[std::min(ply, MAX_SEARCH_PLY - 1)];
+
+		for (uint32_t i = 0; i < moves.size(); ++i) {
+			const BoardMove move = moves[i];
+			if (move == hashMove) {
+				outScores[i] = HASH_MOVE_SCORE;
+			}
+			else if (board.isCapture(move) || move.promotionType == QUEEN) {
+				outScores[i] = CAPTURE_SCORE + mvvLva(board, move);
+			}
+			else if (move == killers[0]) {
+				outScores[i] = KILLER_SCORE;
+			}
+			else if (move == killers[1]) {
+				outScores[i] = KILLER_SCORE - 1;
+			}
+			else if (move == counterMove) {
+				outScores[i] = COUNTER_MOVE_SCORE;
+			}
+			else {
+				outScores[i] = m_history[historyIndex(color, move)];
+			}
+		}
+	}
+
+	// Selection sort step, moves the best move of [index, size) to index.
+	// Searches usually cut off after a few moves so sorting the whole vector is wasted work
+	static inline void pickNextMove(MovesVector& moves, MoveScores& scores, const uint32_t index) {
+		uint32_t bestIndex = index;
+		for (uint32_t i = index + 1; i < moves.size(); ++i) {
+			if (scores[i] > scores[bestIndex]) {
+				bestIndex = i;
+			}
+		}
+		std::swap(moves[index], moves[bestIndex]);
+		std::swap(scores[index], scores[bestIndex]);
+	}
+
+	// moves[0, cutoffIndex] must be the moves searched at this node in the order they were searched
+	inline void updateOnCutoff(const ChessBoard& board, const MovesVector& moves, const uint32_t cutoffIndex,
+			const BoardMove previousMove, const uint32_t ply, const uint8_t depth) {
+		const BoardMove move = moves[cutoffIndex];
+		if (board.isCapture(move)) {
+			return;
+		}
+
+		auto& killers = m_killers[std::min(ply, MAX_SEARCH_PLY - 1)];
+		if (killers[0] != move) {
+			killers[1] = killers[0];
+			killers[0] = move;
+		}
+
+		if (previousMove.isValid()) {
+			m_counterMoves[counterMoveIndex(board, previousMove)] = move;
+		}
+
+		const Color color = board.getNextPlayerColor();
+		const int32_t bonus = std::min(static_cast<int32_t>(depth) * depth, MAX_HISTORY);
+		updateHistory(m_history[historyIndex(color, move)], bonus);
+		for (uint32_t i = 0; i < cutoffIndex; ++i) {
+			if (!board.isCapture(moves[i])) {
+				updateHistory(m_history[historyIndex(color, moves[i])], -bonus);
+			}
+		}
+	}
+
+private:
+	static constexpr int32_t HASH_MOVE_SCORE = 1 << 30;
+	static constexpr int32_t CAPTURE_SCORE = 1 << 28;
+	static constexpr int32_t KILLER_SCORE = 1 << 27;
+	static constexpr int32_t COUNTER_MOVE_SCORE = 1 << 26;
+	static constexpr int32_t MAX_HISTORY = 1 << 14; // quiet scores are kept in [-MAX_HISTORY, MAX_HISTORY]
+	static constexpr uint32_t TILES = BOARD_SIZE * BOARD_SIZE;
+
+	std::array<std::array<BoardMove, KILLERS_PER_PLY>, MAX_SEARCH_PLY> m_killers;
+	std::array<int32_t, 2 * TILES * TILES> m_history; // butterfly board: [color][from][to]
+	std::array<BoardMove, 2 * NUM_OF_TYPES * TILES> m_counterMoves; // [previous piece][previous to]
+
+	static constexpr uint32_t historyIndex(const Color color, const BoardMove move) {
+		return (static_cast<uint32_t>(color) * TILES + move.from.asIndex()) * TILES + move.to.asIndex();
+	}
+
+	// The previous move has already been played on the board so its piece sits on previousMove.to
+	static constexpr uint32_t counterMoveIndex(const ChessBoard& board, const BoardMove previousMove) {
+		const BoardTile tile = board.getTile(previousMove.to);
+		return (static_cast<uint32_t>(tile.color) * NUM_OF_TYPES + tile.type) * TILES + previousMove.to.asIndex();
+	}
+
+	// Most valuable victim first, then least valuable attacker. TileType is ordered by value
+	static constexpr int32_t mvvLva(const ChessBoard& board, const BoardMove move) {
+		const TileType victim = move.enPassantPawn.areValid() ? PAWN : board.getTile(move.to).type;
+		const TileType attacker = board.getTile(move.from).type;
+		return (static_cast<int32_t>(victim) + static_cast<int32_t>(move.promotionType)) * NUM_OF_TYPES - attacker;
+	}
+
+	// History gravity, keeps the entries bounded and lets old values fade out
+	static constexpr void updateHistory(int32_t& entry, const int32_t bonus) {
+		entry += bonus - entry * std::abs(bonus) / MAX_HISTORY;
+	}
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+class PawnHashTable;
+class PawnStructureEvaluator;
+
+#include "game/chess-board.h"
+#include "min-max-ai/chess-board-evaluator.hpp"
+
+#include <array>
+#include <bit>
+#include <vector>
+
+static constexpr uint32_t DEFAULT_PAWN_HASH_ENTRIES = 1 << 14;
+
+// Pawn terms from white's point of view, kept apart so they can be tapered with the rest of the evaluation
+struct PawnStructureScores {
+	int16_t midgame;
+	int16_t endgame;
+};
+
+namespace pawnstructure {
+
+static constexpr int16_t DOUBLED_MIDGAME = -1; // for every extra pawn on a file
+static constexpr int16_t DOUBLED_ENDGAME = -2;
+static constexpr int16_t ISOLATED_MIDGAME = -1;
+static constexpr int16_t ISOLATED_ENDGAME = -2;
+static constexpr int16_t BACKWARD_MIDGAME = -1;
+static constexpr int16_t BACKWARD_ENDGAME = -1;
+static constexpr std::array<int16_t, BOARD_SIZE> PASSED_MIDGAME = { 0, 0, 1, 1, 2, 4, 6, 0 }; // by rank from the pawn's side
+static constexpr std::array<int16_t, BOARD_SIZE> PASSED_ENDGAME = { 0, 1, 2, 4, 7, 11, 16, 0 };
+
+// Bit y * 8 + x is set for a pawn on (x, y)
+typedef uint64_t PawnMask;
+
+static constexpr PawnMask FILE_MASK = 0x0101010101010101ull;
+
+constexpr PawnMask fileMask(const int8_t x) {
+	return x < 0 || x >= BOARD_SIZE ? 0 : FILE_MASK << x;
+}
+
+constexpr PawnMask adjacentFilesMask(const int8_t x) {
+	return fileMask(x - 1) | fileMask(x + 1);
+}
+
+// Ranks strictly in front of y for white, behind it for black
+constexpr PawnMask ranksAboveMask(const int8_t y) {
+	return y >= BOARD_SIZE - 1 ? 0 : ~0ull << ((y + 1) * BOARD_SIZE);
+}
+
+constexpr PawnMask ranksBelowMask(const int8_t y) {
+	return y <= 0 ? 0 : ~0ull >> ((BOARD_SIZE - y) * BOARD_SIZE);
+}
+
+constexpr bool hasPawn(const PawnMask pawns, const int8_t x, const int8_t y) {
+	return x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE && (pawns >> (y * BOARD_SIZE + x)) & 1;
+}
+
+// Scores the pawns of one side, forward is the direction they move in
+inline PawnStructureScores evaluateSide(const PawnMask ownPawns, const PawnMask enemyPawns, const int8_t forward) {
+	PawnStructureScores scores = { 0, 0 };
+	for (int8_t x = 0; x < BOARD_SIZE; ++x) {
+		const int32_t pawnsOnFile = std::popcount(ownPawns & fileMask(x));
+		if (pawnsOnFile > 1) {
+			scores.midgame += DOUBLED_MIDGAME * (pawnsOnFile - 1);
+			scores.endgame += DOUBLED_ENDGAME * (pawnsOnFile - 1);
+		}
+	}
+
+	for (PawnMask pawns = ownPawns; pawns != 0; pawns &= pawns - 1) {
+		const int8_t square = std::countr_zero(pawns);
+		const int8_t x = square % BOARD_SIZE;
+		const int8_t y = square / BOARD_SIZE;
+		const PawnMask ahead = forward > 0 ? ranksAboveMask(y) : ranksBelowMask(y);
+		const PawnMask behindOrLevel = ~ahead;
+
+		if ((enemyPawns & ahead & (fileMask(x) | adjacentFilesMask(x))) == 0) {
+			const int8_t rank = forward > 0 ? y : BOARD_SIZE - 1 - y;
+			scores.midgame += PASSED_MIDGAME[rank];
+			scores.endgame += PASSED_ENDGAME[rank];
+		}
+
+		if ((ownPawns & adjacentFilesMask(x)) == 0) {
+			scores.midgame += ISOLATED_MIDGAME;
+			scores.endgame += ISOLATED_ENDGAME;
+		}
+		// No neighbour can come to support it and an enemy pawn controls the square in front of it
+		else if ((ownPawns & adjacentFilesMask(x) & behindOrLevel) == 0
+			&& (hasPawn(enemyPawns, x - 1, y + 2 * forward) || hasPawn(enemyPawns, x + 1, y + 2 * forward))) {
+			scores.midgame += BACKWARD_MIDGAME;
+			scores.endgame += BACKWARD_ENDGAME;
+		}
+	}
+	return scores;
+}
+
+inline PawnStructureScores evaluatePawnStructure(const ChessBoard& board) {
+	PawnMask whitePawns = 0;
+	PawnMask blackPawns = 0;
+	for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+		for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+			const BoardTile tile = board.getTile(x, y);
+			if (tile.type == PAWN) {
+				(tile.color == WHITE ? whitePawns : blackPawns) |= 1ull << (y * BOARD_SIZE + x);
+			}
+		}
+	}
+
+	const PawnStructureScores white = evaluateSide(whitePawns, blackPawns, 1);
+	const PawnStructureScores black = evaluateSide(blackPawns, whitePawns, -1);
+	return { static_cast<int16_t>(white.midgame - black.midgame), static_cast<int16_t>(white.endgame - black.endgame) };
+}
+
+}
+
+// Direct mapped table of pawn structure scores keyed by ChessBoard::getPawnHash.
+// Pawns move rarely compared to the other pieces so almost every lookup is a hit
+class PawnHashTable {
+public:
+	PawnHashTable() : PawnHashTable(DEFAULT_PAWN_HASH_ENTRIES) { }
+	PawnHashTable(const uint32_t entries) {
+		uint32_t size = 1;
+		while (size * 2 <= entries) {
+			size *= 2;
+		}
+		// A board without pawns has a pawn hash of 0 and scores 0, so zeroed entries are already valid
+		m_entries.resize(size, { 0, { 0, 0 } });
+	}
+
+	inline PawnStructureScores getScores(const ChessBoard& board) {
+		const uint64_t pawnHash = board.getPawnHash();
+		Entry& entry = m_entries[pawnHash & (m_entries.size() - 1)];
+		if (entry.pawnHash != pawnHash) {
+			entry.pawnHash = pawnHash;
+			entry.scores = pawnstructure::evaluatePawnStructure(board);
+		}
+		return entry.scores;
+	}
+
+private:
+	struct Entry {
+		uint64_t pawnHash;
+		PawnStructureScores scores;
+	};
+
+	std::vector<Entry> m_entries;
+};
+
+// Piece-square evaluation plus the pawn structure terms, each instance owns its pawn table
+class PawnStructureEvaluator {
+public:
+	static constexpr bool CACHE_EVALUATIONS = false; // both parts are already a lookup
+
+	inline int16_t evaluate(const ChessBoard& board, const MovesVector& availableMoves) {
+		if (availableMoves.empty()) {
+			return evaluateTerminal(board);
+		}
+
+		const PawnStructureScores pawnScores = m_pawnHashTable.getScores(board);
+		return taperEvaluation(board, board.getMidgameScore() + pawnScores.midgame, board.getEndgameScore() + pawnScores.endgame);
+	}
+
+private:
+	PawnHashTable m_pawnHashTable;
+};
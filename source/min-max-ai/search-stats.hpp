@@ -0,0 +1,123 @@
+#pragma once
+
+struct SearchStats;
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Counters of a search, the counters of several searches can be added together
+struct SearchStats {
+	uint64_t nodes = 0; // includes the quiescence nodes
+	uint64_t quiescenceNodes = 0;
+	uint64_t memoProbes = 0;
+	uint64_t memoHits = 0;
+	uint64_t memoStores = 0;
+	uint64_t memoReplacements = 0; // stores that replaced the entry of a different position
+	uint32_t memoHashfull = 0; // per mille of the memo used by the current search
+	uint64_t evaluationCacheProbes = 0;
+	uint64_t evaluationCacheHits = 0;
+	uint64_t cutoffs = 0;
+	uint64_t firstMoveCutoffs = 0;
+	uint32_t depth = 0;
+	uint32_t selectiveDepth = 0;
+	double seconds = 0.0;
+	std::vector<uint64_t> iterationNodes; // nodes of every iterative deepening iteration
+
+	inline SearchStats& operator+=(const SearchStats& other) {
+		nodes += other.nodes;
+		quiescenceNodes += other.quiescenceNodes;
+		memoProbes += other.memoProbes;
+		memoHits += other.memoHits;
+		memoStores += other.memoStores;
+		memoReplacements += other.memoReplacements;
+		memoHashfull = std::max(memoHashfull, other.memoHashfull);
+		evaluationCacheProbes += other.evaluationCacheProbes;
+		evaluationCacheHits += other.evaluationCacheHits;
+		cutoffs += other.cutoffs;
+		firstMoveCutoffs += other.firstMoveCutoffs;
+		depth = std::max(depth, other.depth);
+		selectiveDepth = std::max(selectiveDepth, other.selectiveDepth);
+		seconds = std::max(seconds, other.seconds);
+		iterationNodes.resize(std::max(iterationNodes.size(), other.iterationNodes.size()), 0);
+		for (size_t i = 0; i < other.iterationNodes.size(); ++i) {
+			iterationNodes[i] += other.iterationNodes[i];
+		}
+		return *this;
+	}
+
+	inline double nodesPerSecond() const {
+		return seconds > 0.0 ? nodes / seconds : 0.0;
+	}
+
+	inline double memoHitRate() const {
+		return ratio(memoHits, memoProbes);
+	}
+
+	inline double memoReplacementRate() const {
+		return ratio(memoReplacements, memoStores);
+	}
+
+	inline double evaluationCacheHitRate() const {
+		return ratio(evaluationCacheHits, evaluationCacheProbes);
+	}
+
+	inline double firstMoveCutoffRate() const {
+		return ratio(firstMoveCutoffs, cutoffs);
+	}
+
+	// Growth of the tree between the last two iterations
+	inline double effectiveBranchingFactor() const {
+		if (iterationNodes.size() < 2) {
+			return 0.0;
+		}
+		return ratio(iterationNodes.back(), iterationNodes[iterationNodes.size() - 2]);
+	}
+
+	void print(std::ostream& out) const {
+		out << "Depth: " << depth << ", selective depth: " << selectiveDepth << '\n'
+			<< "Nodes: " << nodes << ", quiescence: " << quiescenceNodes
+			<< ", nodes/sec: " << static_cast<uint64_t>(nodesPerSecond()) << ", time: " << seconds << "s" << '\n'
+			<< "Memo: " << memoProbes << " probes, hit rate: " << memoHitRate() * 100.0 << "%"
+			<< ", replacement rate: " << memoReplacementRate() * 100.0 << "%, hashfull: " << memoHashfull << "/1000" << '\n'
+			<< "Evaluation cache: " << evaluationCacheProbes << " probes, hit rate: " << evaluationCacheHitRate() * 100.0 << "%" << '\n'
+			<< "Cutoffs: " << cutoffs << ", on first move: " << firstMoveCutoffRate() * 100.0 << "%" << '\n'
+			<< "Effective branching factor: " << effectiveBranchingFactor() << '\n';
+	}
+
+	// Single line JSON object, meant to be collected by scripts and compared across builds
+	void printJson(std::ostream& out) const {
+		out << "{\"depth\":" << depth
+			<< ",\"seldepth\":" << selectiveDepth
+			<< ",\"nodes\":" << nodes
+			<< ",\"qnodes\":" << quiescenceNodes
+			<< ",\"nps\":" << static_cast<uint64_t>(nodesPerSecond())
+			<< ",\"seconds\":" << seconds
+			<< ",\"memo_probes\":" << memoProbes
+			<< ",\"memo_hit_rate\":" << memoHitRate()
+			<< ",\"memo_replacement_rate\":" << memoReplacementRate()
+			<< ",\"hashfull\":" << memoHashfull
+			<< ",\"eval_cache_probes\":" << evaluationCacheProbes
+			<< ",\"eval_cache_hit_rate\":" << evaluationCacheHitRate()
+			<< ",\"cutoffs\":" << cutoffs
+			<< ",\"first_move_cutoff_rate\":" << firstMoveCutoffRate()
+			<< ",\"ebf\":" << effectiveBranchingFactor()
+			<< ",\"iteration_nodes\":";
+		printArray(out, iterationNodes);
+		out << "}" << '\n';
+	}
+
+private:
+	static inline double ratio(const uint64_t a, const uint64_t b) {
+		return b == 0 ? 0.0 : static_cast<double>(a) / static_cast<double>(b);
+	}
+
+	static void printArray(std::ostream& out, const std::vector<uint64_t>& values) {
+		out << "[";
+		for (size_t i = 0; i < values.size(); ++i) {
+			out << (i == 0 ? "" : ",") << values[i];
+		}
+		out << "]";
+	}
+};
@@ -0,0 +1,100 @@
+#include "min-max-ai/self-play-generator.h"
+#include "min-max-ai/min-max-ai-player.h"
+#include "tools/random-generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int32_t CENTIPAWNS_PER_EVALUATION = 10; // the search scores in tenths of a pawn
+
+// Mate scores do not fit in centipawns, they are clamped to the range of the record
+int16_t toCentipawns(const int16_t evaluation) {
+	return static_cast<int16_t>(std::clamp<int32_t>(evaluation * CENTIPAWNS_PER_EVALUATION,
+		std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max()));
+}
+
+int8_t playGame(const SelfPlaySettings& settings, MinMaxAiPlayer<>& white, MinMaxAiPlayer<>& black,
+		RandomGenerator& rgen, std::vector<PositionRecord>& outRecords) {
+	ChessBoard board = settings.startPosition.empty() ? ChessBoard() : ChessBoard(settings.startPosition);
+	MovesVector moves;
+	for (uint32_t ply = 0; ply < settings.maxPlies; ++ply) {
+		if (board.isDraw()) {
+			return 0;
+		}
+		moves.clear();
+		board.getNextPlayerMoves(moves);
+		if (moves.empty()) {
+			if (!board.isKingInCheck(board.getNextPlayerColor())) {
+				return 0;
+			}
+			return board.getNextPlayerColor() == WHITE ? -1 : 1;
+		}
+
+		if (ply < settings.randomOpeningPlies) {
+			board.playMove(moves[rgen.getUint32() % moves.size()]);
+			continue;
+		}
+		MinMaxAiPlayer<>& player = board.getNextPlayerColor() == WHITE ? white : black;
+		const std::vector<SearchLine>& lines = player.analyze(board);
+		if (lines.empty() || lines[0].moves.empty()) {
+			board.playMove(moves[0]);
+			continue;
+		}
+		outRecords.emplace_back(board, toCentipawns(lines[0].evaluation), 0);
+		board.playMove(lines[0].moves[0]);
+	}
+	return 0;
+}
+
+}
+
+SelfPlayReport generateSelfPlayDataset(const std::string& path, const SelfPlaySettings& settings) {
+	SelfPlayReport report;
+	PositionWriter writer;
+	if (!writer.open(path)) {
+		return report;
+	}
+
+	std::mutex writerLock;
+	std::atomic<uint32_t> nextGame(0);
+	const auto work = [&]() {
+		// The players and their tables are kept for all the games of the thread
+		MinMaxAiPlayer<> white(Color::WHITE, false);
+		MinMaxAiPlayer<> black(Color::BLACK, false);
+		for (MinMaxAiPlayer<>* player : { &white, &black }) {
+			player->setSearchDepth(settings.searchDepth);
+		}
+		std::vector<PositionRecord> records;
+		uint32_t game;
+		while ((game = nextGame.fetch_add(1)) < settings.games) {
+			RandomGenerator rgen(settings.seed * settings.games + game);
+			records.clear();
+			const int8_t result = playGame(settings, white, black, rgen, records);
+			for (PositionRecord& record : records) {
+				record.result = result;
+			}
+			std::lock_guard<std::mutex> lock(writerLock);
+			writer.write(records.data(), records.size());
+			report.games++;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < std::max<uint32_t>(settings.threads, 1); ++i) {
+		threads.emplace_back(work);
+	}
+	work();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	report.positions = writer.getWritten();
+	report.written = writer.close();
+	return report;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+struct SelfPlaySettings;
+struct SelfPlayReport;
+
+#include "game/position-dataset.h"
+
+#include <cstdint>
+#include <string>
+
+struct SelfPlaySettings {
+	uint32_t games = 100;
+	uint32_t threads = 1;
+	uint8_t searchDepth = 4;
+	uint32_t randomOpeningPlies = 8; // random moves before the search plays, so the games differ
+	uint32_t maxPlies = 300;
+	uint64_t seed = 0;
+	std::string startPosition; // FEN every game starts from, the standard start position if empty
+};
+
+struct SelfPlayReport {
+	uint64_t games = 0;
+	uint64_t positions = 0;
+	bool written = false;
+};
+
+// Plays min max games on many threads and writes the position before every searched move to a dataset file,
+// labeled with the score of the search in centipawns and the result of the game. The positions of the random
+// opening are not written. A thread keeps the records of its game until it ends, then appends them to the shared writer
+SelfPlayReport generateSelfPlayDataset(const std::string& path, const SelfPlaySettings& settings);
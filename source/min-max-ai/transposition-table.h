@@ -0,0 +1,151 @@
+#pragma once
+
+class TranspositionTable;
+
+#include "game/chess-board.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+static constexpr size_t DEFAULT_TRANSPOSITION_TABLE_MB = 64;
+
+// What the stored evaluation tells about the real one
+enum MemoBound : uint8_t {
+	BOUND_NONE,
+	BOUND_UPPER, // the search failed low, the real evaluation is at most this
+	BOUND_LOWER, // the search failed high, the real evaluation is at least this
+	BOUND_EXACT,
+};
+
+// Evaluations are from the point of view of the player to move in the position
+struct TranspositionEntry {
+	uint64_t hash;
+	int16_t evaluation;
+	uint8_t depth;
+	MemoBound bound : 2;
+	uint8_t age : 6;
+	BoardMove bestMove;
+
+	// True if the entry settles the evaluation inside the (alpha, beta) window
+	constexpr bool isUsable(const uint8_t searchDepth, const int16_t alpha, const int16_t beta) const {
+		return depth >= searchDepth
+			&& (bound == BOUND_EXACT
+				|| (bound == BOUND_LOWER && evaluation >= beta)
+				|| (bound == BOUND_UPPER && evaluation <= alpha));
+	}
+};
+static_assert(sizeof(TranspositionEntry) == 2 * sizeof(uint64_t));
+
+// Fixed size table of positions, kept alive between searches so a new search starts warm.
+// Each bucket fills a cache line. When a bucket is full, the entry with the lowest depth is replaced,
+// entries from older searches lose value the older they get
+class TranspositionTable {
+public:
+	TranspositionTable() : TranspositionTable(DEFAULT_TRANSPOSITION_TABLE_MB) { }
+	TranspositionTable(const size_t sizeInMB)
+			: m_age(0) {
+		size_t buckets = 1;
+		while (buckets * 2 * sizeof(Bucket) <= sizeInMB * 1024 * 1024) {
+			buckets *= 2;
+		}
+		m_buckets.resize(buckets);
+		clear();
+	}
+
+	inline void clear() {
+		for (auto& bucket : m_buckets) {
+			for (auto& entry : bucket.entries) {
+				entry.hash = EMPTY_HASH;
+				entry.depth = 0;
+				entry.bound = BOUND_NONE;
+				entry.age = 0;
+				entry.bestMove = INVALID_MOVE;
+			}
+		}
+	}
+
+	// Called at the start of every search so the entries of the previous ones can be replaced first
+	inline void newSearch() {
+		m_age = (m_age + 1) & AGE_MASK;
+	}
+
+	inline const TranspositionEntry* probe(const uint64_t hash) const {
+		for (const auto& entry : bucketFor(hash).entries) {
+			if (entry.hash == hash) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	// Returns true if the entry of a different position was replaced
+	inline bool store(const uint64_t hash, const int16_t evaluation, const uint8_t depth, const MemoBound bound, const BoardMove bestMove) {
+		Bucket& bucket = bucketFor(hash);
+		TranspositionEntry* replace = &bucket.entries[0];
+		for (auto& entry : bucket.entries) {
+			if (entry.hash == hash) {
+				replace = &entry;
+				break;
+			}
+			if (replacementValue(entry) < replacementValue(*replace)) {
+				replace = &entry;
+			}
+		}
+
+		const bool isReplacement = replace->hash != hash && replace->hash != EMPTY_HASH;
+
+		// Keep the old best move when the new search did not find one, it is still good for ordering
+		if (replace->hash != hash || bestMove.isValid()) {
+			replace->bestMove = bestMove;
+		}
+		replace->hash = hash;
+		replace->evaluation = evaluation;
+		replace->depth = depth;
+		replace->bound = bound;
+		replace->age = m_age;
+		return isReplacement;
+	}
+
+	// Per mille of the entries written by the current search, sampled from the first buckets
+	inline uint32_t getHashfull() const {
+		const size_t sampledBuckets = std::min<size_t>(m_buckets.size(), HASHFULL_SAMPLE / ENTRIES_PER_BUCKET);
+		uint32_t used = 0;
+		for (size_t i = 0; i < sampledBuckets; ++i) {
+			for (const auto& entry : m_buckets[i].entries) {
+				used += entry.hash != EMPTY_HASH && entry.age == m_age;
+			}
+		}
+		return used * 1000 / (sampledBuckets * ENTRIES_PER_BUCKET);
+	}
+
+private:
+	static constexpr uint32_t ENTRIES_PER_BUCKET = 4;
+	static constexpr uint8_t AGE_MASK = 0x3f;
+	static constexpr uint64_t EMPTY_HASH = 0; // a real position hashing to 0 is unlikely enough to ignore
+	static constexpr uint32_t HASHFULL_SAMPLE = 1000;
+	static constexpr int32_t AGE_PENALTY = 8; // an entry from a search ago is worth as much as one 8 plies shallower
+
+	struct alignas(ENTRIES_PER_BUCKET * sizeof(TranspositionEntry)) Bucket {
+		std::array<TranspositionEntry, ENTRIES_PER_BUCKET> entries;
+	};
+
+	std::vector<Bucket> m_buckets;
+	uint8_t m_age;
+
+	inline Bucket& bucketFor(const uint64_t hash) {
+		return m_buckets[hash & (m_buckets.size() - 1)];
+	}
+
+	inline const Bucket& bucketFor(const uint64_t hash) const {
+		return m_buckets[hash & (m_buckets.size() - 1)];
+	}
+
+	constexpr int32_t replacementValue(const TranspositionEntry& entry) const {
+		if (entry.hash == EMPTY_HASH) {
+			return INT32_MIN;
+		}
+		const int32_t ageDistance = (m_age - entry.age) & AGE_MASK;
+		return static_cast<int32_t>(entry.depth) - AGE_PENALTY * ageDistance;
+	}
+};
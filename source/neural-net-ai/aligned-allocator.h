@@ -0,0 +1,34 @@
+#pragma once
+
+template <typename T> struct AlignedAllocator;
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+static constexpr size_t PACKED_ALIGNMENT = 64;
+
+// Allocator of cache line aligned vectors, the packed weights and buffers start on a line
+template <typename T>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U>&) { }
+
+	inline T* allocate(const size_t size) {
+		return static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t(PACKED_ALIGNMENT)));
+	}
+
+	inline void deallocate(T* data, const size_t) {
+		::operator delete(data, std::align_val_t(PACKED_ALIGNMENT));
+	}
+
+	template <typename U>
+	inline bool operator==(const AlignedAllocator<U>&) const {
+		return true;
+	}
+};
+
+typedef std::vector<float, AlignedAllocator<float>> AlignedFloats;
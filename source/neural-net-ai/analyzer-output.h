@@ -0,0 +1,16 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// The analyzer output is the expected game result from white's point of view, -1 for a black win and 1 for a white
+// win. SupervisedTrainer fits it to the game result mixed with tanh(score / ANALYZER_SCORE_SCALE), the search trees
+// work in tenths of a pawn and read the output through analyzerOutputToEvaluation
+static constexpr float ANALYZER_SCORE_SCALE = 400.0f; // centipawns of search score that give an output of tanh(1)
+static constexpr float ANALYZER_MAX_OUTPUT = 0.999f; // about 15 pawns, far from the mate evaluations
+static constexpr float ANALYZER_EVALUATION_SCALE = ANALYZER_SCORE_SCALE / 10.0f; // the same scale in tenths of a pawn
+
+// Inverse of the score part of the target. The last layer is linear, so the output is clamped first
+inline float analyzerOutputToEvaluation(const float output) {
+	return std::atanh(std::clamp(output, -ANALYZER_MAX_OUTPUT, ANALYZER_MAX_OUTPUT)) * ANALYZER_EVALUATION_SCALE;
+}
@@ -0,0 +1,57 @@
+#include "neural-net-ai/async-nnai-player.h"
+
+#include <algorithm>
+
+bool AnalyzerBatchQueue::flush() {
+	std::lock_guard<std::mutex> flushLock(m_flushLock);
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::swap(m_pending, m_flushing);
+	}
+	if (m_flushing.empty()) {
+		return false;
+	}
+
+	const uint32_t neurons = m_analyzer->firstLayer.getNumOfNeurons();
+	uint32_t rows = 0;
+	for (const Request& request : m_flushing) {
+		rows += request.rows;
+	}
+	m_sums.resize(static_cast<size_t>(rows) * neurons);
+	m_outputs.resize(rows);
+	uint32_t row = 0;
+	for (const Request& request : m_flushing) {
+		std::copy(request.sums, request.sums + static_cast<size_t>(request.rows) * neurons, m_sums.begin() + static_cast<size_t>(row) * neurons);
+		row += request.rows;
+	}
+	m_analyzer->network.feedBatchFromFirstLayer(m_sums.data(), rows, m_outputs.data(), m_packedBuffer);
+
+	row = 0;
+	for (const Request& request : m_flushing) {
+		std::copy(m_outputs.begin() + row, m_outputs.begin() + row + request.rows, request.outputs);
+		row += request.rows;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_batches++;
+		m_requests += m_flushing.size();
+	}
+	for (const Request& request : m_flushing) {
+		m_scheduler->schedule(request.handle);
+	}
+	m_flushing.clear();
+	return true;
+}
+
+Task<MoveResult> AsyncNNAIPlayer::getMove(const ChessBoard& board, BoardMove* outMove) {
+	MovesVector moves;
+	board.getMoves(m_color, moves);
+	if (moves.empty()) {
+		co_return MoveResult::OUT_OF_MOVES;
+	}
+
+	const uint32_t rows = m_batch.prepare(m_queue->getAnalyzer(), nullptr, board, moves);
+	co_await m_queue->evaluate(m_batch.getSums(), rows, m_batch.getOutputs());
+	*outMove = moves[m_batch.choose(nullptr, m_color)];
+	co_return MoveResult::MOVE_OK;
+}
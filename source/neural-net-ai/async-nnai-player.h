@@ -0,0 +1,108 @@
+#pragma once
+
+class AnalyzerBatchQueue;
+class AsyncNNAIPlayer;
+
+#include "game/async-game.h"
+#include "game/game-scheduler.h"
+#include "neural-net-ai/nnai-player.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Collects the analyzer batches of the coroutine players of one network across games. A player suspends on
+// evaluate() and the scheduler flushes the queue when no game can go on, the rows of every waiting player are
+// fed through the network together and the players are scheduled again. Create it before the scheduler runs
+// and keep it until the run ends
+class AnalyzerBatchQueue {
+public:
+	AnalyzerBatchQueue() = delete;
+	AnalyzerBatchQueue(const AnalyzerBatchQueue& other) = delete;
+	AnalyzerBatchQueue(std::shared_ptr<const CompiledAnalyzer> analyzer, GameScheduler* scheduler)
+			: m_analyzer(std::move(analyzer))
+			, m_scheduler(scheduler)
+			, m_batches(0)
+			, m_requests(0) {
+		assert(m_analyzer && m_scheduler);
+		m_scheduler->addIdleHandler([this] { return flush(); });
+	}
+
+	struct Evaluation {
+		AnalyzerBatchQueue* queue;
+		const float* sums;
+		uint32_t rows;
+		float* outputs;
+
+		inline bool await_ready() const noexcept { return rows == 0; }
+		inline void await_suspend(const std::coroutine_handle<> handle) const { queue->submit({ sums, rows, outputs, handle }); }
+		inline void await_resume() const noexcept { }
+	};
+
+	// Awaitable that writes the outputs of rows first layer sums, sums and outputs have to stay valid until it resumes
+	inline Evaluation evaluate(const float* sums, const uint32_t rows, float* outputs) {
+		return { this, sums, rows, outputs };
+	}
+
+	// Runs every pending request in one batch, returns true if there were any
+	bool flush();
+
+	inline const CompiledAnalyzer& getAnalyzer() const {
+		return *m_analyzer;
+	}
+
+	inline uint64_t getBatches() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_batches;
+	}
+
+	inline uint64_t getRequests() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_requests;
+	}
+
+private:
+	struct Request {
+		const float* sums;
+		uint32_t rows;
+		float* outputs;
+		std::coroutine_handle<> handle;
+	};
+
+	std::shared_ptr<const CompiledAnalyzer> m_analyzer;
+	GameScheduler* m_scheduler;
+	mutable std::mutex m_lock;
+	std::vector<Request> m_pending;
+	uint64_t m_batches;
+	uint64_t m_requests;
+	std::mutex m_flushLock; // guards the buffers of flush
+	std::vector<Request> m_flushing;
+	std::vector<float> m_sums;
+	std::vector<float> m_outputs;
+	PackedBuffer m_packedBuffer;
+
+	inline void submit(const Request& request) {
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_pending.push_back(request);
+	}
+};
+
+// NNAIPlayer for AsyncGame, the batch of a move waits in the queue with the batches of the other games of the
+// network. Games of a network run on many threads at once, so there is no evaluation cache
+class AsyncNNAIPlayer : public AsyncPlayer {
+public:
+	AsyncNNAIPlayer() = delete;
+	AsyncNNAIPlayer(Color color, AnalyzerBatchQueue* queue)
+			: AsyncPlayer(color)
+			, m_queue(queue) {
+		assert(queue);
+	}
+
+	Task<MoveResult> getMove(const ChessBoard& board, BoardMove* outMove) override final;
+
+private:
+	AnalyzerBatchQueue* m_queue;
+	AnalyzerMoveBatch m_batch;
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+class DenseNetwork;
+struct DenseBuffer;
+
+#include "tools/random-generator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class DenseActivation : uint8_t {
+	LINEAR,
+	RELU,
+	LEAKY_RELU,
+	TANH,
+	SIGMOID,
+};
+
+// Scratch space of a forward pass, one per thread. Grows to the widest layer times the largest batch
+struct DenseBuffer {
+	std::vector<float> input;
+	std::vector<float> output;
+
+	inline void reserve(const size_t size) {
+		if (input.size() < size) {
+			input.resize(size);
+			output.resize(size);
+		}
+	}
+};
+
+// Fully connected network kept in cai's own layout: every layer is a row major [outputs][inputs] matrix
+// and a bias vector. Hidden layers use the hidden activation, the last layer is linear.
+// A batch is a row major [batch][inputs] matrix, every weight row is read once for the whole batch
+class DenseNetwork {
+public:
+	DenseNetwork() = default;
+	DenseNetwork(const std::vector<uint32_t>& layerSizes, const DenseActivation hiddenActivation)
+			: m_layerSizes(layerSizes)
+			, m_hiddenActivation(hiddenActivation)
+			, m_maxLayerSize(0) {
+		assert(layerSizes.size() >= 2);
+		for (uint32_t layer = 0; layer + 1 < layerSizes.size(); ++layer) {
+			m_weightOffsets.push_back(m_weights.size());
+			m_biasOffsets.push_back(m_biases.size());
+			m_weights.resize(m_weights.size() + static_cast<size_t>(layerSizes[layer]) * layerSizes[layer + 1], 0.0f);
+			m_biases.resize(m_biases.size() + layerSizes[layer + 1], 0.0f);
+		}
+		m_maxLayerSize = *std::max_element(layerSizes.begin(), layerSizes.end());
+	}
+
+	inline void initRandomUniform(const float min, const float max, RandomGenerator& rgen) {
+		for (float& weight : m_weights) {
+			weight = rgen.get(min, max);
+		}
+		for (float& bias : m_biases) {
+			bias = rgen.get(min, max);
+		}
+	}
+
+	// He initialization for the hidden activation, the weights of a neuron are uniform in +-sqrt(6 / inputs) and the
+	// biases are 0, so the scale of the values stays the same through deep layers
+	inline void initHeUniform(RandomGenerator& rgen) {
+		for (uint32_t layer = 0; layer < getNumOfLayers(); ++layer) {
+			const float limit = std::sqrt(6.0f / m_layerSizes[layer]);
+			float* weights = getWeights(layer);
+			for (size_t i = 0; i < static_cast<size_t>(m_layerSizes[layer]) * m_layerSizes[layer + 1]; ++i) {
+				weights[i] = rgen.get(-limit, limit);
+			}
+		}
+		std::fill(m_biases.begin(), m_biases.end(), 0.0f);
+	}
+
+	inline const std::vector<uint32_t>& getLayerSizes() const {
+		return m_layerSizes;
+	}
+
+	// Number of weight layers, one less than the layer sizes
+	inline uint32_t getNumOfLayers() const {
+		return m_layerSizes.size() - 1;
+	}
+
+	inline uint32_t getInputSize() const {
+		return m_layerSizes.front();
+	}
+
+	inline uint32_t getOutputSize() const {
+		return m_layerSizes.back();
+	}
+
+	inline size_t getNumOfWeights() const {
+		return m_weights.size();
+	}
+
+	inline size_t getNumOfBiases() const {
+		return m_biases.size();
+	}
+
+	inline DenseActivation getHiddenActivation() const {
+		return m_hiddenActivation;
+	}
+
+	inline float* getWeights(const uint32_t layer) {
+		return m_weights.data() + m_weightOffsets[layer];
+	}
+
+	inline const float* getWeights(const uint32_t layer) const {
+		return m_weights.data() + m_weightOffsets[layer];
+	}
+
+	inline float* getBiases(const uint32_t layer) {
+		return m_biases.data() + m_biasOffsets[layer];
+	}
+
+	inline const float* getBiases(const uint32_t layer) const {
+		return m_biases.data() + m_biasOffsets[layer];
+	}
+
+	inline DenseActivation getActivation(const uint32_t layer) const {
+		return layer + 1 == getNumOfLayers() ? DenseActivation::LINEAR : m_hiddenActivation;
+	}
+
+	// outputs is a row major [batch][output size] matrix
+	void feedBatch(const float* inputs, const uint32_t batchSize, float* outputs, DenseBuffer& buffer) const {
+		assert(batchSize > 0);
+		buffer.reserve(static_cast<size_t>(m_maxLayerSize) * batchSize);
+		std::copy(inputs, inputs + static_cast<size_t>(getInputSize()) * batchSize, buffer.input.begin());
+		for (uint32_t layer = 0; layer < getNumOfLayers(); ++layer) {
+			feedLayer(layer, buffer.input.data(), batchSize, buffer.output.data());
+			std::swap(buffer.input, buffer.output);
+		}
+		std::copy(buffer.input.begin(), buffer.input.begin() + static_cast<size_t>(getOutputSize()) * batchSize, outputs);
+	}
+
+	// Same as feedBatch for inputs whose first layer sums, biases included and before the activation, are already known.
+	// firstLayerSums is a row major [batch][first hidden layer size] matrix
+	void feedBatchFromFirstLayer(const float* firstLayerSums, const uint32_t batchSize, float* outputs, DenseBuffer& buffer) const {
+		assert(batchSize > 0);
+		buffer.reserve(static_cast<size_t>(m_maxLayerSize) * batchSize);
+		const DenseActivation activation = getActivation(0);
+		const size_t sums = static_cast<size_t>(m_layerSizes[1]) * batchSize;
+		for (size_t i = 0; i < sums; ++i) {
+			buffer.input[i] = activate(activation, firstLayerSums[i]);
+		}
+		for (uint32_t layer = 1; layer < getNumOfLayers(); ++layer) {
+			feedLayer(layer, buffer.input.data(), batchSize, buffer.output.data());
+			std::swap(buffer.input, buffer.output);
+		}
+		std::copy(buffer.input.begin(), buffer.input.begin() + static_cast<size_t>(getOutputSize()) * batchSize, outputs);
+	}
+
+	inline float feed(const float* input, DenseBuffer& buffer) const {
+		assert(getOutputSize() == 1);
+		float output;
+		feedBatch(input, 1, &output, buffer);
+		return output;
+	}
+
+	bool saveToDisk(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+		write(file, FILE_VERSION);
+		write(file, static_cast<uint32_t>(m_layerSizes.size()));
+		file.write(reinterpret_cast<const char*>(m_layerSizes.data()), m_layerSizes.size() * sizeof(uint32_t));
+		write(file, static_cast<uint8_t>(m_hiddenActivation));
+		file.write(reinterpret_cast<const char*>(m_weights.data()), m_weights.size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(m_biases.data()), m_biases.size() * sizeof(float));
+		return static_cast<bool>(file);
+	}
+
+	bool loadFromDisk(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		char magic[sizeof(FILE_MAGIC)];
+		uint32_t version = 0;
+		uint32_t numOfSizes = 0;
+		uint8_t activation = 0;
+		if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+				|| !read(file, version) || version != FILE_VERSION || !read(file, numOfSizes) || numOfSizes < 2) {
+			return false;
+		}
+		std::vector<uint32_t> layerSizes(numOfSizes);
+		if (!file.read(reinterpret_cast<char*>(layerSizes.data()), layerSizes.size() * sizeof(uint32_t)) || !read(file, activation)) {
+			return false;
+		}
+		DenseNetwork network(layerSizes, static_cast<DenseActivation>(activation));
+		file.read(reinterpret_cast<char*>(network.m_weights.data()), network.m_weights.size() * sizeof(float));
+		file.read(reinterpret_cast<char*>(network.m_biases.data()), network.m_biases.size() * sizeof(float));
+		if (!file) {
+			return false;
+		}
+		*this = std::move(network);
+		return true;
+	}
+
+	static inline float activate(const DenseActivation activation, const float value) {
+		switch (activation) {
+		case DenseActivation::RELU:			return std::max(value, 0.0f);
+		case DenseActivation::LEAKY_RELU:	return value > 0.0f ? value : LEAKY_RELU_SLOPE * value;
+		case DenseActivation::TANH:			return std::tanh(value);
+		case DenseActivation::SIGMOID:		return 1.0f / (1.0f + std::exp(-value));
+		default:							return value;
+		}
+	}
+
+	// Derivative of the activation at the sum value, before the activation
+	static inline float derivative(const DenseActivation activation, const float value) {
+		switch (activation) {
+		case DenseActivation::RELU:			return value > 0.0f ? 1.0f : 0.0f;
+		case DenseActivation::LEAKY_RELU:	return value > 0.0f ? 1.0f : LEAKY_RELU_SLOPE;
+		case DenseActivation::TANH: {
+			const float activated = std::tanh(value);
+			return 1.0f - activated * activated;
+		}
+		case DenseActivation::SIGMOID: {
+			const float activated = 1.0f / (1.0f + std::exp(-value));
+			return activated * (1.0f - activated);
+		}
+		default:							return 1.0f;
+		}
+	}
+
+private:
+	static constexpr float LEAKY_RELU_SLOPE = 0.01f;
+	static constexpr uint32_t BATCH_BLOCK = 4; // batch rows that share one pass over a weight row
+	static constexpr uint32_t LANES = 8;
+	static constexpr uint32_t FILE_VERSION = 1;
+	static constexpr char FILE_MAGIC[4] = { 'C', 'A', 'I', 'N' };
+
+	std::vector<uint32_t> m_layerSizes;
+	std::vector<float> m_weights;
+	std::vector<float> m_biases;
+	std::vector<size_t> m_weightOffsets;
+	std::vector<size_t> m_biasOffsets;
+	DenseActivation m_hiddenActivation = DenseActivation::LINEAR;
+	uint32_t m_maxLayerSize = 0;
+
+	template <typename T>
+	static inline void write(std::ofstream& file, const T value) {
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static inline bool read(std::ifstream& file, T& value) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void feedLayer(const uint32_t layer, const float* inputs, const uint32_t batchSize, float* outputs) const {
+		const uint32_t inputSize = m_layerSizes[layer];
+		const uint32_t outputSize = m_layerSizes[layer + 1];
+		const float* weights = getWeights(layer);
+		const float* biases = getBiases(layer);
+		const DenseActivation activation = getActivation(layer);
+
+		for (uint32_t neuron = 0; neuron < outputSize; ++neuron) {
+			const float* row = weights + static_cast<size_t>(neuron) * inputSize;
+			uint32_t b = 0;
+			for (; b + BATCH_BLOCK <= batchSize; b += BATCH_BLOCK) {
+				feedNeuron<BATCH_BLOCK>(row, inputs + static_cast<size_t>(b) * inputSize, inputSize, biases[neuron], activation,
+					outputs + static_cast<size_t>(b) * outputSize + neuron, outputSize);
+			}
+			for (; b < batchSize; ++b) {
+				feedNeuron<1>(row, inputs + static_cast<size_t>(b) * inputSize, inputSize, biases[neuron], activation,
+					outputs + static_cast<size_t>(b) * outputSize + neuron, outputSize);
+			}
+		}
+	}
+
+	// Dot products of one weight row with Rows consecutive inputs. The sums are split in lanes the compiler can
+	// vectorize, the lanes are added in the same order for any Rows so a batch gives the same results as single feeds
+	template <uint32_t Rows>
+	static inline void feedNeuron(const float* row, const float* inputs, const uint32_t inputSize, const float bias,
+			const DenseActivation activation, float* outputs, const uint32_t outputStride) {
+		float lanes[Rows][LANES] = { };
+		uint32_t i = 0;
+		for (; i + LANES <= inputSize; i += LANES) {
+			for (uint32_t r = 0; r < Rows; ++r) {
+				const float* x = inputs + static_cast<size_t>(r) * inputSize + i;
+				for (uint32_t lane = 0; lane < LANES; ++lane) {
+					lanes[r][lane] += row[i + lane] * x[lane];
+				}
+			}
+		}
+		for (uint32_t r = 0; r < Rows; ++r) {
+			const float* x = inputs + static_cast<size_t>(r) * inputSize;
+			float sum = 0.0f;
+			for (uint32_t lane = 0; lane < LANES; ++lane) {
+				sum += lanes[r][lane];
+			}
+			for (uint32_t j = i; j < inputSize; ++j) {
+				sum += row[j] * x[j];
+			}
+			outputs[static_cast<size_t>(r) * outputStride] = activate(activation, sum + bias);
+		}
+	}
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+class InferenceBatcher;
+
+#include "neural-net-ai/packed-network.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr uint32_t DEFAULT_INFERENCE_BATCH_SIZE = 64;
+static constexpr std::chrono::microseconds DEFAULT_INFERENCE_BATCH_WAIT(200);
+
+// Evaluates the positions of many threads that use the same network in batches. A thread submits its input
+// and sleeps, a worker thread collects the pending inputs and feeds them to the network together, so the
+// weights are read once for the whole batch. The worker runs a batch when every client is waiting, when
+// maxBatchSize inputs are pending or when the first input has waited maxWait
+class InferenceBatcher {
+public:
+	InferenceBatcher() = delete;
+	InferenceBatcher(const InferenceBatcher& other) = delete;
+	InferenceBatcher(std::shared_ptr<const PackedNetwork> network, const uint32_t numOfClients,
+			const uint32_t maxBatchSize = DEFAULT_INFERENCE_BATCH_SIZE,
+			const std::chrono::microseconds maxWait = DEFAULT_INFERENCE_BATCH_WAIT)
+			: m_network(std::move(network))
+			, m_flushSize(std::max<uint32_t>(std::min(numOfClients, maxBatchSize), 1))
+			, m_maxBatchSize(std::max<uint32_t>(maxBatchSize, 1))
+			, m_maxWait(maxWait)
+			, m_stop(false)
+			, m_batches(0)
+			, m_requests(0) {
+		assert(m_network && m_network->getOutputSize() == 1);
+		m_worker = std::thread(&InferenceBatcher::run, this);
+	}
+
+	~InferenceBatcher() {
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stop = true;
+		}
+		m_requestAdded.notify_one();
+		m_worker.join();
+	}
+
+	// Blocks until the batch with input is run. input has to stay valid until then
+	float evaluate(const float* input) {
+		Request request = { input, 0.0f, false };
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_pending.push_back(&request);
+		m_requestAdded.notify_one();
+		m_batchDone.wait(lock, [&] { return request.done; });
+		return request.output;
+	}
+
+	inline uint64_t getBatches() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_batches;
+	}
+
+	inline uint64_t getRequests() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_requests;
+	}
+
+private:
+	struct Request {
+		const float* input;
+		float output;
+		bool done;
+	};
+
+	std::shared_ptr<const PackedNetwork> m_network;
+	uint32_t m_flushSize;
+	uint32_t m_maxBatchSize;
+	std::chrono::microseconds m_maxWait;
+	mutable std::mutex m_lock;
+	std::condition_variable m_requestAdded;
+	std::condition_variable m_batchDone;
+	std::vector<Request*> m_pending;
+	bool m_stop;
+	uint64_t m_batches;
+	uint64_t m_requests;
+	std::thread m_worker;
+
+	void run() {
+		std::vector<Request*> batch;
+		std::vector<float> inputs;
+		std::vector<float> outputs;
+		PackedBuffer buffer;
+		const uint32_t inputSize = m_network->getInputSize();
+
+		std::unique_lock<std::mutex> lock(m_lock);
+		while (true) {
+			m_requestAdded.wait(lock, [&] { return m_stop || !m_pending.empty(); });
+			if (m_pending.empty()) {
+				return;
+			}
+			m_requestAdded.wait_for(lock, m_maxWait, [&] { return m_stop || m_pending.size() >= m_flushSize; });
+
+			const uint32_t batchSize = std::min<uint32_t>(m_pending.size(), m_maxBatchSize);
+			batch.assign(m_pending.begin(), m_pending.begin() + batchSize);
+			m_pending.erase(m_pending.begin(), m_pending.begin() + batchSize);
+			lock.unlock();
+
+			inputs.resize(static_cast<size_t>(batchSize) * inputSize);
+			outputs.resize(batchSize);
+			for (uint32_t i = 0; i < batchSize; ++i) {
+				std::copy(batch[i]->input, batch[i]->input + inputSize, inputs.begin() + static_cast<size_t>(i) * inputSize);
+			}
+			m_network->feedBatch(inputs.data(), batchSize, outputs.data(), buffer);
+
+			lock.lock();
+			for (uint32_t i = 0; i < batchSize; ++i) {
+				batch[i]->output = outputs[i];
+				batch[i]->done = true;
+			}
+			m_batches++;
+			m_requests += batchSize;
+			m_batchDone.notify_all();
+		}
+	}
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+class LayerPool;
+
+#include "neural-net-ai/aligned-allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+typedef std::shared_ptr<const AlignedFloats> SharedFloats;
+
+// Interns the weight arrays of compiled networks. Arrays with the same values are stored once and shared by
+// reference count, so networks compiled at the same time only pay for the layers that differ between them.
+// Shared arrays are never written, a network with a changed layer gets a new array. The pool only keeps weak
+// references, an array is freed with the last network that uses it and its entry with the next intern.
+// Safe to use from many threads
+class LayerPool {
+public:
+	LayerPool() = default;
+	LayerPool(const LayerPool& other) = delete;
+
+	SharedFloats intern(AlignedFloats&& values) {
+		const uint64_t hash = hashOf(values);
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::erase_if(m_arrays, [](const auto& entry) { return entry.second.expired(); });
+		auto [begin, end] = m_arrays.equal_range(hash);
+		for (auto it = begin; it != end; ++it) {
+			SharedFloats shared = it->second.lock();
+			if (shared && shared->size() == values.size() && std::memcmp(shared->data(), values.data(), values.size() * sizeof(float)) == 0) {
+				return shared;
+			}
+		}
+		SharedFloats shared = std::make_shared<const AlignedFloats>(std::move(values));
+		m_arrays.emplace(hash, shared);
+		return shared;
+	}
+
+	// Bytes of the arrays still in use, every shared array counted once
+	size_t getUniqueBytes() const {
+		std::lock_guard<std::mutex> lock(m_lock);
+		size_t bytes = 0;
+		for (const auto& [hash, array] : m_arrays) {
+			if (const SharedFloats shared = array.lock()) {
+				bytes += shared->size() * sizeof(float);
+			}
+		}
+		return bytes;
+	}
+
+private:
+	mutable std::mutex m_lock;
+	std::unordered_multimap<uint64_t, std::weak_ptr<const AlignedFloats>> m_arrays;
+
+	// FNV-1a over the bits of the values
+	static inline uint64_t hashOf(const AlignedFloats& values) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (const float value : values) {
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			hash = (hash ^ bits) * 0x100000001b3ull;
+		}
+		return hash ^ values.size();
+	}
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+class FirstLayerColumns;
+struct NetworkAccumulator;
+
+#include "game/chess-board.h"
+#include "neural-net-ai/dense-network.h"
+
+#include <algorithm>
+#include <vector>
+
+// Input of a square in the board encoding of the analyzer, the same order as ChessBoard::asFloats
+constexpr uint32_t boardInputIndex(const TileCoords coords) {
+	return coords.x * BOARD_SIZE + coords.y;
+}
+
+// First layer sums of one position: biases plus every weight column times the value of its square, before the activation
+struct NetworkAccumulator {
+	std::vector<float> sums;
+};
+
+// The first layer of a DenseNetwork that takes the board encoding, stored by columns so the inputs of one square
+// are a contiguous vector. A move changes two to four squares, so a child's accumulator is the parent's
+// plus a few scaled columns instead of a full pass over the first layer
+class FirstLayerColumns {
+public:
+	FirstLayerColumns() = default;
+	FirstLayerColumns(const DenseNetwork& network)
+			: m_neurons(network.getLayerSizes()[1])
+			, m_biases(network.getBiases(0), network.getBiases(0) + network.getLayerSizes()[1])
+			, m_columns(static_cast<size_t>(BOARD_SIZE) * BOARD_SIZE * network.getLayerSizes()[1]) {
+		assert(network.getInputSize() == BOARD_SIZE * BOARD_SIZE);
+		const float* weights = network.getWeights(0);
+		for (uint32_t neuron = 0; neuron < m_neurons; ++neuron) {
+			for (uint32_t input = 0; input < BOARD_SIZE * BOARD_SIZE; ++input) {
+				m_columns[static_cast<size_t>(input) * m_neurons + neuron] = weights[static_cast<size_t>(neuron) * BOARD_SIZE * BOARD_SIZE + input];
+			}
+		}
+	}
+
+	inline uint32_t getNumOfNeurons() const {
+		return m_neurons;
+	}
+
+	// Full computation, for the root of a search or a position that was not reached by a move
+	inline void refresh(const ChessBoard& board, NetworkAccumulator& outAccumulator) const {
+		outAccumulator.sums.assign(m_biases.begin(), m_biases.end());
+		for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+			for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+				const float value = board.getTile(x, y).asFloat();
+				if (value != 0.0f) {
+					addColumn(boardInputIndex(TileCoords(x, y)), value, outAccumulator.sums.data());
+				}
+			}
+		}
+	}
+
+	// The accumulator of parent after move. child is parent with move already played
+	inline void update(const NetworkAccumulator& parentAccumulator, const ChessBoard& parent, const BoardMove move,
+			const ChessBoard& child, NetworkAccumulator& outAccumulator) const {
+		outAccumulator.sums.resize(m_neurons);
+		update(parentAccumulator, parent, move, child, outAccumulator.sums.data());
+	}
+
+	// Writes the sums straight to outSums, a row of a batch for DenseNetwork::feedBatchFromFirstLayer
+	inline void update(const NetworkAccumulator& parentAccumulator, const ChessBoard& parent, const BoardMove move,
+			const ChessBoard& child, float* outSums) const {
+		assert(parentAccumulator.sums.size() == m_neurons);
+		std::copy(parentAccumulator.sums.begin(), parentAccumulator.sums.end(), outSums);
+		const auto updateSquare = [&](const TileCoords coords) {
+			const float delta = child.getTile(coords).asFloat() - parent.getTile(coords).asFloat();
+			if (delta != 0.0f) {
+				addColumn(boardInputIndex(coords), delta, outSums);
+			}
+		};
+
+		updateSquare(move.from);
+		updateSquare(move.to);
+		if (move.enPassantPawn.areValid()) {
+			updateSquare(move.enPassantPawn);
+		}
+		if (move.isCastle(parent.getTile(move.from).type)) {
+			const bool isLong = move.to.x == KING_LONG_CASTLE_X;
+			updateSquare(TileCoords(isLong ? 0 : BOARD_SIZE - 1, move.from.y));
+			updateSquare(TileCoords(isLong ? ROOK_LONG_CASTLE_X : ROOK_SHORT_CASTLE_X, move.from.y));
+		}
+	}
+
+private:
+	uint32_t m_neurons = 0;
+	std::vector<float> m_biases;
+	std::vector<float> m_columns; // [square input][neuron]
+
+	inline void addColumn(const uint32_t input, const float scale, float* sums) const {
+		const float* column = m_columns.data() + static_cast<size_t>(input) * m_neurons;
+		for (uint32_t neuron = 0; neuron < m_neurons; ++neuron) {
+			sums[neuron] += scale * column[neuron];
+		}
+	}
+};
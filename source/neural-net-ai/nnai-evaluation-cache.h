@@ -0,0 +1,80 @@
+#pragma once
+
+class NNAIEvaluationCache;
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+static constexpr uint32_t DEFAULT_NNAI_EVALUATION_CACHE_ENTRIES = 1 << 14;
+
+// Direct mapped cache of the analyzer outputs of one network, keyed by ChessBoard::getHash().
+// The cache belongs to a network, not a game, so positions repeated across games skip inference.
+// The values are only valid for the weights they came from, the owner passes a version of the network
+// to validate and a new version clears the cache. One thread uses a cache at a time
+class NNAIEvaluationCache {
+public:
+	NNAIEvaluationCache() : NNAIEvaluationCache(DEFAULT_NNAI_EVALUATION_CACHE_ENTRIES) { }
+	NNAIEvaluationCache(const uint32_t entries)
+			: m_networkVersion(0)
+			, m_hits(0)
+			, m_misses(0) {
+		uint32_t size = 1;
+		while (size * 2 <= entries) {
+			size *= 2;
+		}
+		m_entries.resize(size);
+	}
+
+	inline void clear() {
+		std::fill(m_entries.begin(), m_entries.end(), Entry());
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+	// Clears the cache if the network changed since it was filled
+	inline void validate(const uint64_t networkVersion) {
+		if (networkVersion != m_networkVersion) {
+			clear();
+			m_networkVersion = networkVersion;
+		}
+	}
+
+	inline bool probe(const uint64_t hash, float& outEvaluation) {
+		const Entry& entry = m_entries[hash & (m_entries.size() - 1)];
+		if (entry.hash != hash) {
+			m_misses++;
+			return false;
+		}
+		m_hits++;
+		outEvaluation = entry.evaluation;
+		return true;
+	}
+
+	inline void store(const uint64_t hash, const float evaluation) {
+		Entry& entry = m_entries[hash & (m_entries.size() - 1)];
+		entry.hash = hash;
+		entry.evaluation = evaluation;
+	}
+
+	inline uint64_t getHits() const {
+		return m_hits;
+	}
+
+	inline uint64_t getMisses() const {
+		return m_misses;
+	}
+
+private:
+	struct Entry {
+		uint64_t hash = EMPTY_HASH;
+		float evaluation = 0.0f;
+	};
+
+	static constexpr uint64_t EMPTY_HASH = 0; // a real position hashing to 0 is unlikely enough to ignore
+
+	std::vector<Entry> m_entries;
+	uint64_t m_networkVersion;
+	uint64_t m_hits;
+	uint64_t m_misses;
+};
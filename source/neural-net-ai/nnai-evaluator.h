@@ -0,0 +1,37 @@
+#pragma once
+
+class NNAIEvaluator;
+
+#include "neural-net-ai/nnai-player.h"
+#include "min-max-ai/chess-board-evaluator.hpp"
+
+#include <algorithm>
+
+// Evaluator policy for MinMaxTree backed by the analyzer network.
+// The output is converted to tenths of a pawn by analyzerOutputToEvaluation
+class NNAIEvaluator {
+public:
+	static constexpr bool CACHE_EVALUATIONS = true;
+
+	NNAIEvaluator() = delete;
+	NNAIEvaluator(const NNAI* ai, nnpp::NeuronBuffer<float>* const neuronBuffer)
+			: m_ai(ai)
+			, m_neuronBuffer(neuronBuffer) {
+		assert(ai && neuronBuffer);
+	}
+
+	inline int16_t evaluate(const ChessBoard& board, const MovesVector& availableMoves) const {
+		if (availableMoves.empty()) {
+			return evaluateTerminal(board);
+		}
+
+		// Only checkmates reach the min and max evaluations
+		const float eval = analyzerOutputToEvaluation(m_ai->feedAt(ANALYZER_NETWORK_INDEX, board.asFloats(), *m_neuronBuffer)[0]);
+		return static_cast<int16_t>(std::clamp(eval, static_cast<float>(CHESS_BOARD_MIN_EVALUATION + 1),
+			static_cast<float>(CHESS_BOARD_MAX_EVALUATION - 1)));
+	}
+
+private:
+	const NNAI* m_ai;
+	nnpp::NeuronBuffer<float>* m_neuronBuffer;
+};
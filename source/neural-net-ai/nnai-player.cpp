@@ -1,7 +1,128 @@
 #include "neural-net-ai/nnai-player.h"
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
+#include <mutex>
+#include <unordered_map>
+
+// Index of the best evaluation for color, evaluations are from white's point of view
+static uint32_t bestEvaluationIndex(const std::vector<float>& evaluations, const Color color) {
+	float bestEval = color == WHITE ? std::numeric_limits<float>::lowest() : std::numeric_limits<float>::max();
+	uint32_t bestEvalIndex = 0;
+	for (uint32_t i = 0; i < evaluations.size(); ++i) {
+		const float eval = evaluations[i];
+		if ((color == WHITE && eval > bestEval) || (color != WHITE && eval < bestEval)) {
+			bestEval = eval;
+			bestEvalIndex = i;
+		}
+	}
+	return bestEvalIndex;
+}
+
+// The positions analyzerMatchesNNPP checks the copies of an analyzer on
+static std::vector<nnpp::NNPPStackVector<float>> referenceInputs() {
+	static const char* REFERENCE_POSITIONS[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"8/5pk1/6p1/3P4/2r5/6P1/5PK1/3R4 b - - 0 40",
+	};
+	std::vector<nnpp::NNPPStackVector<float>> inputs;
+	for (const char* fen : REFERENCE_POSITIONS) {
+		inputs.push_back(ChessBoard(fen).asFloats());
+	}
+	return inputs;
+}
+
+bool analyzerMatchesNNPP(const NNAI& ai, const DenseNetwork& analyzer) {
+	DenseBuffer buffer;
+	return matchesFeedAt(ai, ANALYZER_NETWORK_INDEX, analyzer, buffer, referenceInputs());
+}
+
+bool analyzerMatchesNNPP(const NNAI& ai, const CompiledAnalyzer& analyzer) {
+	PackedBuffer buffer;
+	return matchesFeedAt(ai, ANALYZER_NETWORK_INDEX, analyzer.network, buffer, referenceInputs());
+}
+
+std::optional<DenseNetwork> copyAnalyzer(const NNAI& ai) {
+	std::optional<DenseNetwork> analyzer = toDenseNetwork(ai, ANALYZER_NETWORK_INDEX);
+	if (analyzer && !analyzerMatchesNNPP(ai, *analyzer)) {
+		return std::nullopt;
+	}
+	return analyzer;
+}
+
+// The compiled analyzers of the NNAIs players were built from, so the players of one network share a single copy.
+// An analyzer is only reused while it still matches the NNAI, a network changed since, or a new one at the same
+// address, gets a new copy
+static std::shared_ptr<const CompiledAnalyzer> sharedAnalyzer(const NNAI& ai) {
+	static std::mutex mutex;
+	static std::unordered_map<const NNAI*, std::weak_ptr<const CompiledAnalyzer>> analyzers;
+	std::lock_guard<std::mutex> lock(mutex);
+	std::erase_if(analyzers, [](const auto& entry) { return entry.second.expired(); });
+	const auto it = analyzers.find(&ai);
+	if (it != analyzers.end()) {
+		std::shared_ptr<const CompiledAnalyzer> analyzer = it->second.lock();
+		if (analyzer && analyzerMatchesNNPP(ai, *analyzer)) {
+			return analyzer;
+		}
+	}
+
+	std::shared_ptr<const CompiledAnalyzer> analyzer = compileAnalyzer(ai);
+	if (analyzer) {
+		analyzers[&ai] = analyzer;
+	}
+	return analyzer;
+}
+
+NNAIPlayer::NNAIPlayer(Color color, const NNAI* ai, NNAIEvaluationCache* evaluationCache)
+		: Player(color)
+		, m_analyzer(sharedAnalyzer(*ai))
+		, m_ai(nullptr)
+		, m_evaluationCache(evaluationCache) {
+	if (m_analyzer) {
+		return;
+	}
+	m_ai = ai;
+	m_neuronBuffer = std::make_unique<nnpp::NeuronBuffer<float>>(nnpp::allocNeuronBuffer<float>());
+}
+
+uint32_t AnalyzerMoveBatch::prepare(const CompiledAnalyzer& analyzer, NNAIEvaluationCache* evaluationCache,
+		const ChessBoard& board, const MovesVector& moves) {
+	// The first layer of every position after a move comes from the current position's accumulator and the squares
+	// the move changed. Every position the cache does not have is one row of the batch, the rest of the network
+	// is read once for all of them
+	const FirstLayerColumns& firstLayer = analyzer.firstLayer;
+	const uint32_t neurons = firstLayer.getNumOfNeurons();
+	firstLayer.refresh(board, m_accumulator);
+	m_evaluations.resize(moves.size());
+	m_hashes.resize(moves.size());
+	m_batchMoves.clear();
+	m_batchSums.resize(static_cast<size_t>(moves.size()) * neurons);
+	for (uint32_t i = 0; i < moves.size(); ++i) {
+		ChessBoard next(board);
+		next.playMove(moves[i]);
+		m_hashes[i] = next.getHash();
+		if (evaluationCache && evaluationCache->probe(m_hashes[i], m_evaluations[i])) {
+			continue;
+		}
+		firstLayer.update(m_accumulator, board, moves[i], next, m_batchSums.data() + static_cast<size_t>(m_batchMoves.size()) * neurons);
+		m_batchMoves.push_back(i);
+	}
+	m_batchOutputs.resize(m_batchMoves.size());
+	return m_batchMoves.size();
+}
+
+uint32_t AnalyzerMoveBatch::choose(NNAIEvaluationCache* evaluationCache, const Color color) {
+	for (uint32_t row = 0; row < m_batchMoves.size(); ++row) {
+		const uint32_t i = m_batchMoves[row];
+		m_evaluations[i] = m_batchOutputs[row];
+		if (evaluationCache) {
+			evaluationCache->store(m_hashes[i], m_evaluations[i]);
+		}
+	}
+	return bestEvaluationIndex(m_evaluations, color);
+}
 
 MoveResult NNAIPlayer::getMove(const ChessBoard& board, BoardMove* outMove) {
 	MovesVector moves;
@@ -10,19 +131,64 @@ MoveResult NNAIPlayer::getMove(const ChessBoard& board, BoardMove* outMove) {
 		return MoveResult::OUT_OF_MOVES;
 	}
 
-	float bestEval = m_color == WHITE ? std::numeric_limits<float>::min() : std::numeric_limits<float>::max();
-	uint32_t bestEvalIndex = 0;
+	if (m_quantizedAnalyzer) {
+		*outMove = moves[chooseWithQuantized(board, moves)];
+		return MoveResult::MOVE_OK;
+	}
+	if (!m_analyzer) {
+		*outMove = moves[chooseWithFeedAt(board, moves)];
+		return MoveResult::MOVE_OK;
+	}
+
+	const uint32_t rows = m_batch.prepare(*m_analyzer, m_evaluationCache, board, moves);
+	if (rows > 0) {
+		m_analyzer->network.feedBatchFromFirstLayer(m_batch.getSums(), rows, m_batch.getOutputs(), m_packedBuffer);
+	}
+	*outMove = moves[m_batch.choose(m_evaluationCache, m_color)];
+	return MoveResult::MOVE_OK;
+}
+
+uint32_t NNAIPlayer::chooseWithFeedAt(const ChessBoard& board, const MovesVector& moves) {
+	m_evaluations.resize(moves.size());
 	for (uint32_t i = 0; i < moves.size(); ++i) {
 		ChessBoard next(board);
 		next.playMove(moves[i]);
-		const nnpp::NNPPStackVector<float> values = next.asFloats();
-		const float eval = analyze(values);
-		if ((m_color == WHITE && eval > bestEval) || (m_color != WHITE && eval < bestEval)) {
-			bestEval = eval;
-			bestEvalIndex = i;
+		if (!m_evaluationCache || !m_evaluationCache->probe(next.getHash(), m_evaluations[i])) {
+			m_evaluations[i] = m_ai->feedAt(ANALYZER_NETWORK_INDEX, next.asFloats(), *m_neuronBuffer)[0];
+			if (m_evaluationCache) {
+				m_evaluationCache->store(next.getHash(), m_evaluations[i]);
+			}
 		}
 	}
+	return bestEvaluationIndex(m_evaluations, m_color);
+}
 
-	*outMove = moves[bestEvalIndex];
-	return MoveResult::MOVE_OK;
+uint32_t NNAIPlayer::chooseWithQuantized(const ChessBoard& board, const MovesVector& moves) {
+	// The positions the cache does not have are fed as one batch, m_quantizedMoves keeps their move indices
+	const uint32_t inputSize = m_quantizedAnalyzer->getInputSize();
+	m_evaluations.resize(moves.size());
+	m_quantizedHashes.resize(moves.size());
+	m_quantizedInputs.clear();
+	m_quantizedMoves.clear();
+	for (uint32_t i = 0; i < moves.size(); ++i) {
+		ChessBoard next(board);
+		next.playMove(moves[i]);
+		m_quantizedHashes[i] = next.getHash();
+		if (m_evaluationCache && m_evaluationCache->probe(m_quantizedHashes[i], m_evaluations[i])) {
+			continue;
+		}
+		const nnpp::NNPPStackVector<float> input = next.asFloats();
+		m_quantizedInputs.insert(m_quantizedInputs.end(), input.begin(), input.begin() + inputSize);
+		m_quantizedMoves.push_back(i);
+	}
+
+	m_quantizedOutputs.resize(m_quantizedMoves.size());
+	m_quantizedAnalyzer->feedBatch(m_quantizedInputs.data(), m_quantizedMoves.size(), m_quantizedOutputs.data(), m_quantizedBuffer);
+	for (uint32_t row = 0; row < m_quantizedMoves.size(); ++row) {
+		m_evaluations[m_quantizedMoves[row]] = m_quantizedOutputs[row];
+		if (m_evaluationCache) {
+			m_evaluationCache->store(m_quantizedHashes[m_quantizedMoves[row]], m_quantizedOutputs[row]);
+		}
+	}
+	return bestEvaluationIndex(m_evaluations, m_color);
 }
@@ -1,33 +1,133 @@
 #pragma once
 
 class NNAIPlayer;
+class AnalyzerMoveBatch;
 
 #include "game/player.h"
 #include "tools/random-generator.h"
+#include "neural-net-ai/analyzer-output.h"
 #include "neural-net-ai/cai-population.h"
+#include "neural-net-ai/dense-network.h"
+#include "neural-net-ai/network-accumulator.h"
+#include "neural-net-ai/nnai-evaluation-cache.h"
+#include "neural-net-ai/nnpp-adapter.h"
+#include "neural-net-ai/packed-network.h"
+#include "neural-net-ai/quantized-network.h"
 
 #include <nnpp.hpp>
 
+#include <memory>
+#include <optional>
+
 typedef nnpp::NNAi<float> NNAI;
 
 const float REDUCTION = 1000.0f;
 
+// The analyzer of an NNAI compiled for NNAIPlayer. Compiled once and shared by every player of the network,
+// with a pool the layers are also shared with the other networks of the pool
+struct CompiledAnalyzer {
+	PackedNetwork network;
+	FirstLayerColumns firstLayer;
+
+	CompiledAnalyzer(const DenseNetwork& analyzer, LayerPool* pool)
+			: network(analyzer, pool)
+			, firstLayer(analyzer) {
+		assert(analyzer.getInputSize() == BOARD_SIZE * BOARD_SIZE && analyzer.getOutputSize() == 1);
+	}
+};
+
+// True if the copy of the analyzer of ai gives the values of feedAt on a few reference positions
+bool analyzerMatchesNNPP(const NNAI& ai, const DenseNetwork& analyzer);
+bool analyzerMatchesNNPP(const NNAI& ai, const CompiledAnalyzer& analyzer);
+
+// The analyzer of ai as a DenseNetwork, nullopt if nnpp cannot copy its weights or the copy does not match nnpp
+std::optional<DenseNetwork> copyAnalyzer(const NNAI& ai);
+
+// nullptr in the same cases as copyAnalyzer, the caller then evaluates with feedAt
+inline std::shared_ptr<const CompiledAnalyzer> compileAnalyzer(const NNAI& ai, LayerPool* pool = nullptr) {
+	const std::optional<DenseNetwork> analyzer = copyAnalyzer(ai);
+	return analyzer ? std::make_shared<const CompiledAnalyzer>(*analyzer, pool) : nullptr;
+}
+
+// The analyzer work of one move choice, shared by the players of the analyzer. prepare() finds the first layer of
+// every position after a move and keeps the ones the cache does not have as the rows of a batch, the caller runs
+// the rows through the rest of the network into getOutputs() and choose() picks the move
+class AnalyzerMoveBatch {
+public:
+	// Returns the number of rows of the batch, 0 if every position was cached
+	uint32_t prepare(const CompiledAnalyzer& analyzer, NNAIEvaluationCache* evaluationCache,
+		const ChessBoard& board, const MovesVector& moves);
+	// Returns the index of the best move for color
+	uint32_t choose(NNAIEvaluationCache* evaluationCache, Color color);
+
+	inline const float* getSums() const {
+		return m_batchSums.data();
+	}
+
+	inline float* getOutputs() {
+		return m_batchOutputs.data();
+	}
+
+private:
+	NetworkAccumulator m_accumulator;
+	std::vector<float> m_evaluations;
+	std::vector<uint64_t> m_hashes;
+	std::vector<uint32_t> m_batchMoves; // moves whose evaluation was not cached, one per row of the batch
+	std::vector<float> m_batchSums;
+	std::vector<float> m_batchOutputs;
+};
+
 class NNAIPlayer : public Player {
 public:
 	NNAIPlayer() = delete;
-	NNAIPlayer(Color color, const NNAI* ai, nnpp::NeuronBuffer<float>* const neuronBuffer)
+	// evaluationCache is optional, it has to belong to ai and outlive the player. The players of one ai share its
+	// compiled analyzer. If the compiled analyzer does not match analyzerMatchesNNPP the player evaluates with feedAt instead,
+	// the caller finds out with usesCompiledAnalyzer
+	NNAIPlayer(Color color, const NNAI* ai, NNAIEvaluationCache* evaluationCache = nullptr);
+
+	NNAIPlayer(Color color, const std::shared_ptr<const CompiledAnalyzer>& analyzer, NNAIEvaluationCache* evaluationCache = nullptr)
 			: Player(color)
-			, m_ai(ai)
-			, m_neuronBuffer(neuronBuffer) {
-		assert(neuronBuffer);
+			, m_analyzer(analyzer)
+			, m_ai(nullptr)
+			, m_evaluationCache(evaluationCache) {
+		assert(analyzer);
+	}
+
+	// Evaluates with an int8 copy of the analyzer, every position after a move is fed whole.
+	// The values differ a little from the float analyzer, so evaluationCache must not be shared with float players
+	NNAIPlayer(Color color, const std::shared_ptr<const QuantizedNetwork>& quantizedAnalyzer, NNAIEvaluationCache* evaluationCache = nullptr)
+			: Player(color)
+			, m_ai(nullptr)
+			, m_quantizedAnalyzer(quantizedAnalyzer)
+			, m_evaluationCache(evaluationCache) {
+		assert(quantizedAnalyzer && quantizedAnalyzer->getInputSize() == BOARD_SIZE * BOARD_SIZE && quantizedAnalyzer->getOutputSize() == 1);
 	}
 
 	MoveResult getMove(const ChessBoard& board, BoardMove* outMove) override final;
 
+	// False when the player fell back to feedAt or uses the quantized analyzer
+	inline bool usesCompiledAnalyzer() const {
+		return m_analyzer != nullptr;
+	}
+
 private:
-	const NNAI* m_ai;
+	std::shared_ptr<const CompiledAnalyzer> m_analyzer; // evaluates all the moves of a position in one batch
+	const NNAI* m_ai; // only set when the player falls back to feedAt
+	std::unique_ptr<nnpp::NeuronBuffer<float>> m_neuronBuffer;
+	std::shared_ptr<const QuantizedNetwork> m_quantizedAnalyzer;
+	AnalyzerMoveBatch m_batch;
+	PackedBuffer m_packedBuffer;
+	QuantizedBuffer m_quantizedBuffer;
+	std::vector<float> m_quantizedInputs;
+	std::vector<uint64_t> m_quantizedHashes;
+	std::vector<uint32_t> m_quantizedMoves; // moves whose evaluation was not cached, one per row of the quantized batch
+	std::vector<float> m_quantizedOutputs;
+	std::vector<float> m_evaluations;
+	NNAIEvaluationCache* m_evaluationCache;
 	RandomGenerator m_rgen;
-	nnpp::NeuronBuffer<float>* const m_neuronBuffer;
+
+	uint32_t chooseWithFeedAt(const ChessBoard& board, const MovesVector& moves);
+	uint32_t chooseWithQuantized(const ChessBoard& board, const MovesVector& moves);
 
 	inline void reduce(nnpp::NNPPStackVector<float>& vec) const {
 		for (uint i = 0; i < vec.size(); ++i) {
@@ -36,8 +136,4 @@ private:
 			}
 		}
 	}
-
-	constexpr float analyze(const nnpp::NNPPStackVector<float>& position) const {
-		return m_ai->feedAt(ANALYZER_NETWORK_INDEX, position, *m_neuronBuffer)[0];
-	}
 };
@@ -29,9 +29,12 @@ std::vector<nnpp::NNPPTrainingUpdate<float>> NNAITrainer::runSession(nnpp::Neuro
 	NNAI& white = m_trainee.getNNAiAt(whitePlayerIndex);
 	NNAI& black = m_trainee.getNNAiAt(blackPlayerIndex);
 
-	float pointsForWhite = runGameAgainstRandom(&white, neuronBuffer);
-	float pointsForBlack = runGameAgainstRandom(&black, neuronBuffer);
-	const GameResult result = runGame(&white, &black, neuronBuffer);
+	TraineeState& whiteTrainee = prepareTrainee(whitePlayerIndex);
+	TraineeState& blackTrainee = prepareTrainee(blackPlayerIndex);
+
+	float pointsForWhite = runGameAgainstRandom(whiteTrainee);
+	float pointsForBlack = runGameAgainstRandom(blackTrainee);
+	const GameResult result = runGame(whiteTrainee, blackTrainee);
 	const float gamePoints = calculatePoints(white.getScore(), black.getScore());
 	const float drawPoints = DRAW_POINTS * (gamePoints / POINTS_PER_GAME);
 
@@ -60,6 +63,8 @@ std::vector<nnpp::NNPPTrainingUpdate<float>> NNAITrainer::runSession(nnpp::Neuro
 	scoreUpdates.emplace_back(white, pointsForWhite, false);
 	scoreUpdates.emplace_back(black, pointsForBlack, false);
 
+	releaseTrainee(whitePlayerIndex);
+	releaseTrainee(blackPlayerIndex);
 	{
 		std::lock_guard<std::mutex> lock(m_occupiedSetLock);
 		m_occupied.erase(whitePlayerIndex);
@@ -76,18 +81,40 @@ uint64_t NNAITrainer::sessionsTillEvolution() const {
 	return sessionsTillEvol - m_trainee.getSessionsTrainedThisGen();
 }
 
-GameResult NNAITrainer::runGame(const NNAI* white, const NNAI* black, nnpp::NeuronBuffer<float>& neuronBuffer) const {
+NNAITrainer::TraineeState& NNAITrainer::prepareTrainee(const uint32_t index) {
+	// Only the members of the running sessions have a compiled analyzer, so the trainer holds two per thread
+	// instead of one per member. Networks only change when the population evolves, then the evaluations of the
+	// older generation are dropped
+	TraineeState& trainee = m_trainees[index];
+	trainee.ai = &m_trainee.getNNAiAt(index);
+	trainee.analyzer = compileAnalyzer(*trainee.ai, &m_layerPool);
+	trainee.evaluationCache.validate(m_trainee.getGenerartion());
+	return trainee;
+}
+
+void NNAITrainer::releaseTrainee(const uint32_t index) {
+	m_trainees[index].analyzer.reset();
+}
+
+std::unique_ptr<NNAIPlayer> NNAITrainer::createPlayer(const Color color, TraineeState& trainee) const {
+	if (trainee.analyzer) {
+		return std::make_unique<NNAIPlayer>(color, trainee.analyzer, &trainee.evaluationCache);
+	}
+	return std::make_unique<NNAIPlayer>(color, trainee.ai, &trainee.evaluationCache);
+}
+
+GameResult NNAITrainer::runGame(TraineeState& white, TraineeState& black) const {
 	ChessBoard b;
-	NNAIPlayer whitePlayer(Color::WHITE, white, &neuronBuffer);
-	NNAIPlayer blackPlayer(Color::BLACK, black, &neuronBuffer);
-	Game g(b, &whitePlayer, &blackPlayer, MAX_MOVES_PER_GAME, false);
+	const std::unique_ptr<NNAIPlayer> whitePlayer = createPlayer(Color::WHITE, white);
+	const std::unique_ptr<NNAIPlayer> blackPlayer = createPlayer(Color::BLACK, black);
+	Game g(b, whitePlayer.get(), blackPlayer.get(), MAX_MOVES_PER_GAME, false);
 	return g.start(false);
 }
 
-float NNAITrainer::runGameAgainstRandom(const NNAI* ai, nnpp::NeuronBuffer<float>& neuronBuffer) const {
+float NNAITrainer::runGameAgainstRandom(TraineeState& trainee) const {
 	ChessBoard b;
-	NNAIPlayer aiPlayer(Color::WHITE, ai, &neuronBuffer);
+	const std::unique_ptr<NNAIPlayer> aiPlayer = createPlayer(Color::WHITE, trainee);
 	RandomPlayer random(Color::BLACK);
-	Game g(b, &aiPlayer, &random, MAX_MOVES_PER_RANDOM_GAME, false);
+	Game g(b, aiPlayer.get(), &random, MAX_MOVES_PER_RANDOM_GAME, false);
 	return g.start(false) == GameResult::WHITE_WINS ? RANDOM_WIN_POINTS : 0.0f;
 }
@@ -4,6 +4,8 @@ class AITrainer;
 
 #include "neural-net-ai/cai-population.h"
 #include "neural-net-ai/nnai-player.h"
+#include "neural-net-ai/nnai-evaluation-cache.h"
+#include "neural-net-ai/layer-pool.h"
 #include "game/game.h"
 
 #include <nnpp.hpp>
@@ -36,7 +38,8 @@ public:
 	NNAITrainer(uint32_t sessions, uint32_t threads, CAIPopulation* const population) 
 			: NNPPTrainer<float>(sessions, threads, *population, nnpp::getDefaultEvolutionInfoFloat())
 			, m_indexDist(0, m_trainee.getPopulationSize() - 1)
-			, m_realDist(0.0f, 1.0f) { }
+			, m_realDist(0.0f, 1.0f)
+			, m_trainees(m_trainee.getPopulationSize()) { }
 
 protected:
 	std::vector<nnpp::NNPPTrainingUpdate<float>> runSession(nnpp::NeuronBuffer<float>& neuronBuffer) override final;
@@ -76,6 +79,17 @@ private:
 	std::uniform_int_distribution<uint> m_indexDist;
 	std::unordered_set<uint> m_occupied;
 	std::mutex m_occupiedSetLock;
+	// The state of a population index, only the session that occupies the index uses it. The evaluation cache is kept
+	// between the sessions of a generation, the analyzer is compiled for a session and freed at its end.
+	// The analyzer is null when nnpp cannot copy it, the players of the trainee then evaluate with feedAt
+	struct TraineeState {
+		const NNAI* ai = nullptr;
+		std::shared_ptr<const CompiledAnalyzer> analyzer;
+		NNAIEvaluationCache evaluationCache;
+	};
+
+	LayerPool m_layerPool; // layers the analyzers of the running sessions have in common are stored once
+	std::vector<TraineeState> m_trainees;
 
 	inline static constexpr float calculatePoints(const float score0, const float score1) {
 		constexpr float alpha = 0.007f;
@@ -97,7 +111,10 @@ private:
 		return std::abs(std::sin(m_trainee.getGenerartion() * MUTATION_FREQ_CHANGE)) * MAX_LAYER_MUTATION_CHANCE;
 	}
 
-	GameResult runGame(const NNAI* white, const NNAI* black, nnpp::NeuronBuffer<float>& neuronBuffer) const;
-	float runGameAgainstRandom(const NNAI* ai, nnpp::NeuronBuffer<float>& neuronBuffer) const;
+	TraineeState& prepareTrainee(uint32_t index);
+	void releaseTrainee(uint32_t index);
+	std::unique_ptr<NNAIPlayer> createPlayer(Color color, TraineeState& trainee) const;
+	GameResult runGame(TraineeState& white, TraineeState& black) const;
+	float runGameAgainstRandom(TraineeState& trainee) const;
 	uint32_t findAndStorePlayerIndex();
 };
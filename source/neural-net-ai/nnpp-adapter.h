@@ -0,0 +1,69 @@
+#pragma once
+
+#include "neural-net-ai/dense-network.h"
+
+#include <nnpp.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// Activation nnpp uses for every layer but the output one, DenseNetwork has to match it to give the same values as feedAt
+static constexpr DenseActivation NNPP_HIDDEN_ACTIVATION = DenseActivation::RELU;
+
+// nnpp versions that read the weights of a network one element at a time
+template <typename Network>
+concept NNPPWeightAccessors = requires(const Network& network, const uint32_t index) {
+	network.getLayerSizes();
+	{ network.getWeight(index, index, index) } -> std::convertible_to<float>;
+	{ network.getBias(index, index) } -> std::convertible_to<float>;
+};
+
+// Copies one network of an nnpp ai to a DenseNetwork. This is the only code that reads nnpp's weights,
+// it goes through the element accessors of nnpp::NN so it does not depend on how nnpp lays them out.
+// Returns nullopt with an nnpp that has no such accessors, the callers then evaluate with feedAt
+template <typename AI>
+std::optional<DenseNetwork> toDenseNetwork(const AI& ai, const uint32_t networkIndex) {
+	const auto& network = ai.getConstRefAt(networkIndex);
+	if constexpr (!NNPPWeightAccessors<std::remove_cvref_t<decltype(network)>>) {
+		return std::nullopt;
+	}
+	else {
+		const auto nnppLayerSizes = network.getLayerSizes();
+		const std::vector<uint32_t> layerSizes(nnppLayerSizes.begin(), nnppLayerSizes.end());
+		DenseNetwork dense(layerSizes, NNPP_HIDDEN_ACTIVATION);
+		for (uint32_t layer = 0; layer < dense.getNumOfLayers(); ++layer) {
+			float* weights = dense.getWeights(layer);
+			float* biases = dense.getBiases(layer);
+			for (uint32_t neuron = 0; neuron < layerSizes[layer + 1]; ++neuron) {
+				for (uint32_t input = 0; input < layerSizes[layer]; ++input) {
+					weights[static_cast<size_t>(neuron) * layerSizes[layer] + input] = network.getWeight(layer, neuron, input);
+				}
+				biases[neuron] = network.getBias(layer, neuron);
+			}
+		}
+		return dense;
+	}
+}
+
+// True if network gives the values of feedAt of the network at networkIndex for every input, within a relative tolerance.
+// toDenseNetwork trusts nnpp's accessors and NNPP_HIDDEN_ACTIVATION, a caller that replaces feedAt with the copy
+// checks them with this first. Network is a DenseNetwork or a network compiled from one, Buffer its feed buffer
+template <typename AI, typename Network, typename Buffer>
+bool matchesFeedAt(const AI& ai, const uint32_t networkIndex, const Network& network, Buffer& buffer,
+		const std::vector<nnpp::NNPPStackVector<float>>& inputs, const float tolerance = 1e-3f) {
+	if (inputs.empty() || inputs[0].size() != network.getInputSize() || network.getOutputSize() != 1) {
+		return false;
+	}
+	auto neuronBuffer = nnpp::allocNeuronBuffer<float>();
+	for (const nnpp::NNPPStackVector<float>& input : inputs) {
+		const float expected = ai.feedAt(networkIndex, input, neuronBuffer)[0];
+		if (!(std::abs(network.feed(&input[0], buffer) - expected) <= tolerance * std::max(1.0f, std::abs(expected)))) {
+			return false;
+		}
+	}
+	return true;
+}
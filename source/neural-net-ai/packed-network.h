@@ -0,0 +1,230 @@
+#pragma once
+
+class PackedNetwork;
+struct PackedBuffer;
+
+#include "neural-net-ai/dense-network.h"
+#include "neural-net-ai/aligned-allocator.h"
+#include "neural-net-ai/layer-pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Scratch space of a packed forward pass, one per thread. Sized for the batch on the first feed, never after
+struct PackedBuffer {
+	AlignedFloats input;
+	AlignedFloats output;
+
+	inline void reserve(const size_t size) {
+		if (input.size() < size) {
+			input.resize(size);
+			output.resize(size);
+		}
+	}
+};
+
+// A DenseNetwork compiled for inference. The neurons of every layer are packed in panels of PANEL neurons stored
+// input by input, [panel][input][PANEL], so one input times one contiguous weight vector updates a whole panel
+// and every weight is read once, in order. Panels are split in blocks of inputs that stay in L1 while every row
+// of a batch goes through them.
+// The bias and the activation are applied to the panel sums before they are stored, the activation is a template
+// argument of the kernel. Layer outputs are padded to whole panels and the padding is never read by the next layer.
+// Layers are never written after compilation, copies of a network share them
+class PackedNetwork {
+public:
+	PackedNetwork() = default;
+	// With a pool, layers equal to a layer of another network of the pool share its memory
+	PackedNetwork(const DenseNetwork& network, LayerPool* pool = nullptr)
+			: m_inputSize(network.getInputSize())
+			, m_outputSize(network.getOutputSize())
+			, m_maxPaddedSize(paddedSize(network.getInputSize())) {
+		for (uint32_t layer = 0; layer < network.getNumOfLayers(); ++layer) {
+			PackedLayer& packedLayer = m_layers.emplace_back();
+			packedLayer.inputSize = network.getLayerSizes()[layer];
+			packedLayer.outputSize = network.getLayerSizes()[layer + 1];
+			packedLayer.paddedOutputSize = paddedSize(packedLayer.outputSize);
+			packedLayer.activation = network.getActivation(layer);
+			AlignedFloats packedWeights(static_cast<size_t>(packedLayer.paddedOutputSize) * packedLayer.inputSize, 0.0f);
+			AlignedFloats packedBiases(packedLayer.paddedOutputSize, 0.0f);
+			m_maxPaddedSize = std::max(m_maxPaddedSize, packedLayer.paddedOutputSize);
+
+			const float* weights = network.getWeights(layer);
+			for (uint32_t neuron = 0; neuron < packedLayer.outputSize; ++neuron) {
+				const uint32_t panel = neuron / PANEL;
+				const uint32_t lane = neuron % PANEL;
+				for (uint32_t input = 0; input < packedLayer.inputSize; ++input) {
+					packedWeights[(static_cast<size_t>(panel) * packedLayer.inputSize + input) * PANEL + lane]
+						= weights[static_cast<size_t>(neuron) * packedLayer.inputSize + input];
+				}
+				packedBiases[neuron] = network.getBiases(layer)[neuron];
+			}
+			packedLayer.weights = share(std::move(packedWeights), pool);
+			packedLayer.biases = share(std::move(packedBiases), pool);
+		}
+	}
+
+	inline uint32_t getInputSize() const {
+		return m_inputSize;
+	}
+
+	inline uint32_t getOutputSize() const {
+		return m_outputSize;
+	}
+
+	// outputs is a row major [batch][output size] matrix, same as DenseNetwork::feedBatch
+	void feedBatch(const float* inputs, const uint32_t batchSize, float* outputs, PackedBuffer& buffer) const {
+		assert(batchSize > 0);
+		buffer.reserve(static_cast<size_t>(m_maxPaddedSize) * batchSize);
+		const uint32_t stride = paddedSize(m_inputSize);
+		for (uint32_t b = 0; b < batchSize; ++b) {
+			std::copy(inputs + static_cast<size_t>(b) * m_inputSize, inputs + static_cast<size_t>(b + 1) * m_inputSize,
+				buffer.input.begin() + static_cast<size_t>(b) * stride);
+		}
+		feedLayers(0, stride, batchSize, outputs, buffer);
+	}
+
+	// Same as DenseNetwork::feedBatchFromFirstLayer, firstLayerSums is a row major [batch][first hidden layer size] matrix
+	void feedBatchFromFirstLayer(const float* firstLayerSums, const uint32_t batchSize, float* outputs, PackedBuffer& buffer) const {
+		assert(batchSize > 0);
+		buffer.reserve(static_cast<size_t>(m_maxPaddedSize) * batchSize);
+		const PackedLayer& firstLayer = m_layers.front();
+		for (uint32_t b = 0; b < batchSize; ++b) {
+			const float* sums = firstLayerSums + static_cast<size_t>(b) * firstLayer.outputSize;
+			float* values = buffer.input.data() + static_cast<size_t>(b) * firstLayer.paddedOutputSize;
+			for (uint32_t neuron = 0; neuron < firstLayer.outputSize; ++neuron) {
+				values[neuron] = DenseNetwork::activate(firstLayer.activation, sums[neuron]);
+			}
+		}
+		feedLayers(1, firstLayer.paddedOutputSize, batchSize, outputs, buffer);
+	}
+
+	inline float feed(const float* input, PackedBuffer& buffer) const {
+		assert(m_outputSize == 1);
+		float output;
+		feedBatch(input, 1, &output, buffer);
+		return output;
+	}
+
+private:
+	static constexpr uint32_t PANEL = 16; // neurons of a panel, one AVX-512 or two AVX2 vectors of float
+	static constexpr uint32_t BATCH_BLOCK = 4; // batch rows that share one pass over a block
+	static constexpr uint32_t INPUT_BLOCK = 256; // inputs of a panel block, 16KB of weights that stay in L1 for the whole batch
+	static constexpr uint32_t CHAINS = 2; // sums every row splits its inputs between, the same for every batch size
+
+	// The sums of one panel, a vector of the compiler's vector extension so one weight vector is one load
+	typedef float PanelVector __attribute__((vector_size(PANEL * sizeof(float))));
+
+	struct PackedLayer {
+		uint32_t inputSize = 0;
+		uint32_t outputSize = 0;
+		uint32_t paddedOutputSize = 0;
+		DenseActivation activation = DenseActivation::LINEAR;
+		SharedFloats weights; // [panel][input][PANEL]
+		SharedFloats biases;
+	};
+
+	std::vector<PackedLayer> m_layers;
+	uint32_t m_inputSize = 0;
+	uint32_t m_outputSize = 0;
+	uint32_t m_maxPaddedSize = 0;
+
+	static inline SharedFloats share(AlignedFloats&& values, LayerPool* pool) {
+		return pool ? pool->intern(std::move(values)) : std::make_shared<const AlignedFloats>(std::move(values));
+	}
+
+	static inline uint32_t paddedSize(const uint32_t size) {
+		return (size + PANEL - 1) / PANEL * PANEL;
+	}
+
+	// Runs the layers from firstLayer on, buffer.input holds their input with inputStride floats per row
+	void feedLayers(const uint32_t firstLayer, uint32_t inputStride, const uint32_t batchSize, float* outputs, PackedBuffer& buffer) const {
+		for (uint32_t layer = firstLayer; layer < m_layers.size(); ++layer) {
+			const PackedLayer& packedLayer = m_layers[layer];
+			switch (packedLayer.activation) {
+			case DenseActivation::RELU:
+				feedLayer<DenseActivation::RELU>(packedLayer, buffer.input.data(), inputStride, batchSize, buffer.output.data());
+				break;
+			case DenseActivation::LEAKY_RELU:
+				feedLayer<DenseActivation::LEAKY_RELU>(packedLayer, buffer.input.data(), inputStride, batchSize, buffer.output.data());
+				break;
+			case DenseActivation::TANH:
+				feedLayer<DenseActivation::TANH>(packedLayer, buffer.input.data(), inputStride, batchSize, buffer.output.data());
+				break;
+			case DenseActivation::SIGMOID:
+				feedLayer<DenseActivation::SIGMOID>(packedLayer, buffer.input.data(), inputStride, batchSize, buffer.output.data());
+				break;
+			default:
+				feedLayer<DenseActivation::LINEAR>(packedLayer, buffer.input.data(), inputStride, batchSize, buffer.output.data());
+				break;
+			}
+			std::swap(buffer.input, buffer.output);
+			inputStride = packedLayer.paddedOutputSize;
+		}
+		for (uint32_t b = 0; b < batchSize; ++b) {
+			const float* values = buffer.input.data() + static_cast<size_t>(b) * inputStride;
+			std::copy(values, values + m_outputSize, outputs + static_cast<size_t>(b) * m_outputSize);
+		}
+	}
+
+	template <DenseActivation Activation>
+	static void feedLayer(const PackedLayer& layer, const float* inputs, const uint32_t inputStride, const uint32_t batchSize, float* outputs) {
+		for (uint32_t panel = 0; panel < layer.paddedOutputSize / PANEL; ++panel) {
+			const float* biases = layer.biases->data() + panel * PANEL;
+			for (uint32_t blockStart = 0; blockStart < layer.inputSize; blockStart += INPUT_BLOCK) {
+				const uint32_t blockSize = std::min(INPUT_BLOCK, layer.inputSize - blockStart);
+				const float* weights = layer.weights->data() + (static_cast<size_t>(panel) * layer.inputSize + blockStart) * PANEL;
+				const float* start = blockStart == 0 ? biases : nullptr;
+				const bool last = blockStart + blockSize == layer.inputSize;
+				uint32_t b = 0;
+				for (; b + BATCH_BLOCK <= batchSize; b += BATCH_BLOCK) {
+					feedPanel<Activation, BATCH_BLOCK>(weights, start, inputs + static_cast<size_t>(b) * inputStride + blockStart, inputStride,
+						blockSize, last, outputs + static_cast<size_t>(b) * layer.paddedOutputSize + panel * PANEL, layer.paddedOutputSize);
+				}
+				for (; b < batchSize; ++b) {
+					feedPanel<Activation, 1>(weights, start, inputs + static_cast<size_t>(b) * inputStride + blockStart, inputStride,
+						blockSize, last, outputs + static_cast<size_t>(b) * layer.paddedOutputSize + panel * PANEL, layer.paddedOutputSize);
+				}
+			}
+		}
+	}
+
+	// Adds one block of inputs to the panel sums of Rows rows. The first block starts from the biases, the sums of the
+	// blocks in between wait in outputs and the last block applies the activation. Every row splits its inputs between
+	// CHAINS sums so the multiply adds do not wait on each other. The split does not depend on Rows, so a row gets
+	// the same value whatever batch it is fed in
+	template <DenseActivation Activation, uint32_t Rows>
+	static inline void feedPanel(const float* weights, const float* biases, const float* inputs, const uint32_t inputStride,
+			const uint32_t blockSize, const bool last, float* outputs, const uint32_t outputStride) {
+		const PanelVector* w = reinterpret_cast<const PanelVector*>(weights);
+		PanelVector sums[Rows][CHAINS] = { };
+		for (uint32_t r = 0; r < Rows; ++r) {
+			sums[r][0] = *reinterpret_cast<const PanelVector*>(biases ? biases : outputs + static_cast<size_t>(r) * outputStride);
+		}
+		uint32_t i = 0;
+		for (; i + CHAINS <= blockSize; i += CHAINS) {
+			for (uint32_t chain = 0; chain < CHAINS; ++chain) {
+				for (uint32_t r = 0; r < Rows; ++r) {
+					sums[r][chain] += inputs[static_cast<size_t>(r) * inputStride + i + chain] * w[i + chain];
+				}
+			}
+		}
+		for (; i < blockSize; ++i) {
+			for (uint32_t r = 0; r < Rows; ++r) {
+				sums[r][0] += inputs[static_cast<size_t>(r) * inputStride + i] * w[i];
+			}
+		}
+
+		for (uint32_t r = 0; r < Rows; ++r) {
+			for (uint32_t chain = 1; chain < CHAINS; ++chain) {
+				sums[r][0] += sums[r][chain];
+			}
+			float* rowOutputs = outputs + static_cast<size_t>(r) * outputStride;
+			for (uint32_t lane = 0; lane < PANEL; ++lane) {
+				rowOutputs[lane] = last ? DenseNetwork::activate(Activation, sums[r][0][lane]) : sums[r][0][lane];
+			}
+		}
+	}
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+class QuantizedNetwork;
+struct QuantizedBuffer;
+struct QuantizationError;
+
+#include "neural-net-ai/dense-network.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if (defined(__AVX512VNNI__) && defined(__AVX512BW__)) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace quantized {
+
+static constexpr uint32_t ROW_ALIGNMENT = 64; // rows are padded with zeros to whole vectors of every kernel
+static constexpr int32_t MAX_VALUE = 127;
+static constexpr uint32_t FILE_VERSION = 1;
+static constexpr char FILE_MAGIC[4] = { 'C', 'A', 'I', 'Q' };
+
+inline uint32_t paddedSize(const uint32_t size) {
+	return (size + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+}
+
+// Scale that maps the largest magnitude of values to MAX_VALUE
+inline float scaleOf(const float* values, const uint32_t size) {
+	float maxAbs = 0.0f;
+	for (uint32_t i = 0; i < size; ++i) {
+		maxAbs = std::max(maxAbs, std::abs(values[i]));
+	}
+	return maxAbs > 0.0f ? maxAbs / MAX_VALUE : 1.0f;
+}
+
+inline int8_t quantize(const float value, const float inverseScale) {
+	const int32_t q = static_cast<int32_t>(std::lround(value * inverseScale));
+	return static_cast<int8_t>(std::clamp(q, -MAX_VALUE, MAX_VALUE));
+}
+
+inline const char* getKernelName() {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+	return "avx512-vnni";
+#elif defined(__AVX2__)
+	return "avx2";
+#else
+	return "scalar";
+#endif
+}
+
+// Exact int32 dot product of two int8 rows of size, a multiple of ROW_ALIGNMENT. weightSum is the sum of the weights,
+// VNNI only multiplies unsigned by signed bytes so the inputs are shifted by 128 and the shift is taken back from the sum
+inline int32_t dot(const int8_t* weights, const int8_t* inputs, const uint32_t size, const int32_t weightSum) {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+	const __m512i shift = _mm512_set1_epi8(static_cast<char>(0x80));
+	__m512i sums = _mm512_setzero_si512();
+	for (uint32_t i = 0; i < size; i += 64) {
+		const __m512i x = _mm512_xor_si512(_mm512_loadu_si512(inputs + i), shift);
+		sums = _mm512_dpbusd_epi32(sums, x, _mm512_loadu_si512(weights + i));
+	}
+	return _mm512_reduce_add_epi32(sums) - 128 * weightSum;
+#elif defined(__AVX2__)
+	__m256i sums = _mm256_setzero_si256();
+	for (uint32_t i = 0; i < size; i += 32) {
+		const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs + i));
+		const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+		sums = _mm256_add_epi32(sums, _mm256_madd_epi16(
+			_mm256_cvtepi8_epi16(_mm256_castsi256_si128(x)), _mm256_cvtepi8_epi16(_mm256_castsi256_si128(w))));
+		sums = _mm256_add_epi32(sums, _mm256_madd_epi16(
+			_mm256_cvtepi8_epi16(_mm256_extracti128_si256(x, 1)), _mm256_cvtepi8_epi16(_mm256_extracti128_si256(w, 1))));
+	}
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int32_t sum = 0;
+	for (uint32_t i = 0; i < size; ++i) {
+		sum += static_cast<int32_t>(weights[i]) * inputs[i];
+	}
+	return sum;
+#endif
+}
+
+}
+
+// Scratch space of a quantized forward pass, one per thread
+struct QuantizedBuffer {
+	std::vector<float> values;
+	std::vector<float> next;
+	std::vector<int8_t> quantized;
+};
+
+// Difference between the float and the quantized outputs of a set of inputs
+struct QuantizationError {
+	float maxError = 0.0f;
+	float meanError = 0.0f;
+	float maxOutput = 0.0f; // largest float output magnitude, to put the errors in scale
+};
+
+// int8 copy of a DenseNetwork, a quarter of the memory of the float weights. Every weight row has its own scale,
+// the input of every layer is quantized with one scale when it is fed. The dot products are exact in int32,
+// the scales, biases and activations are applied in float
+class QuantizedNetwork {
+public:
+	QuantizedNetwork() = default;
+	QuantizedNetwork(const DenseNetwork& network) {
+		for (uint32_t layer = 0; layer < network.getNumOfLayers(); ++layer) {
+			QuantizedLayer& quantizedLayer = m_layers.emplace_back();
+			quantizedLayer.inputSize = network.getLayerSizes()[layer];
+			quantizedLayer.outputSize = network.getLayerSizes()[layer + 1];
+			quantizedLayer.paddedInputSize = quantized::paddedSize(quantizedLayer.inputSize);
+			quantizedLayer.activation = network.getActivation(layer);
+			quantizedLayer.weights.resize(static_cast<size_t>(quantizedLayer.outputSize) * quantizedLayer.paddedInputSize, 0);
+			quantizedLayer.weightScales.resize(quantizedLayer.outputSize);
+			quantizedLayer.weightSums.resize(quantizedLayer.outputSize);
+			quantizedLayer.biases.assign(network.getBiases(layer), network.getBiases(layer) + quantizedLayer.outputSize);
+
+			for (uint32_t neuron = 0; neuron < quantizedLayer.outputSize; ++neuron) {
+				const float* row = network.getWeights(layer) + static_cast<size_t>(neuron) * quantizedLayer.inputSize;
+				int8_t* quantizedRow = quantizedLayer.weights.data() + static_cast<size_t>(neuron) * quantizedLayer.paddedInputSize;
+				const float scale = quantized::scaleOf(row, quantizedLayer.inputSize);
+				int32_t sum = 0;
+				for (uint32_t input = 0; input < quantizedLayer.inputSize; ++input) {
+					quantizedRow[input] = quantized::quantize(row[input], 1.0f / scale);
+					sum += quantizedRow[input];
+				}
+				quantizedLayer.weightScales[neuron] = scale;
+				quantizedLayer.weightSums[neuron] = sum;
+			}
+		}
+	}
+
+	inline uint32_t getInputSize() const {
+		return m_layers.front().inputSize;
+	}
+
+	inline uint32_t getOutputSize() const {
+		return m_layers.back().outputSize;
+	}
+
+	inline uint32_t getNumOfLayers() const {
+		return m_layers.size();
+	}
+
+	// Bytes of the int8 weights, padding included
+	inline size_t getWeightBytes() const {
+		size_t bytes = 0;
+		for (const QuantizedLayer& layer : m_layers) {
+			bytes += layer.weights.size();
+		}
+		return bytes;
+	}
+
+	// outputs is a row major [batch][output size] matrix, same as DenseNetwork::feedBatch
+	void feedBatch(const float* inputs, const uint32_t batchSize, float* outputs, QuantizedBuffer& buffer) const {
+		for (uint32_t b = 0; b < batchSize; ++b) {
+			feedRow(inputs + static_cast<size_t>(b) * getInputSize(), outputs + static_cast<size_t>(b) * getOutputSize(), buffer);
+		}
+	}
+
+	inline float feed(const float* input, QuantizedBuffer& buffer) const {
+		assert(getOutputSize() == 1);
+		float output;
+		feedRow(input, &output, buffer);
+		return output;
+	}
+
+	bool saveToDisk(const std::string& path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		file.write(quantized::FILE_MAGIC, sizeof(quantized::FILE_MAGIC));
+		write(file, quantized::FILE_VERSION);
+		write(file, getNumOfLayers());
+		for (const QuantizedLayer& layer : m_layers) {
+			write(file, layer.inputSize);
+			write(file, layer.outputSize);
+			write(file, static_cast<uint8_t>(layer.activation));
+			file.write(reinterpret_cast<const char*>(layer.weights.data()), layer.weights.size());
+			file.write(reinterpret_cast<const char*>(layer.weightScales.data()), layer.weightScales.size() * sizeof(float));
+			file.write(reinterpret_cast<const char*>(layer.biases.data()), layer.biases.size() * sizeof(float));
+		}
+		return static_cast<bool>(file);
+	}
+
+	bool loadFromDisk(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		char magic[sizeof(quantized::FILE_MAGIC)];
+		uint32_t version = 0;
+		uint32_t numOfLayers = 0;
+		if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, quantized::FILE_MAGIC, sizeof(magic)) != 0
+				|| !read(file, version) || version != quantized::FILE_VERSION || !read(file, numOfLayers) || numOfLayers == 0) {
+			return false;
+		}
+		std::vector<QuantizedLayer> layers(numOfLayers);
+		for (QuantizedLayer& layer : layers) {
+			uint8_t activation = 0;
+			if (!read(file, layer.inputSize) || !read(file, layer.outputSize) || !read(file, activation)) {
+				return false;
+			}
+			layer.paddedInputSize = quantized::paddedSize(layer.inputSize);
+			layer.activation = static_cast<DenseActivation>(activation);
+			layer.weights.resize(static_cast<size_t>(layer.outputSize) * layer.paddedInputSize);
+			layer.weightScales.resize(layer.outputSize);
+			layer.biases.resize(layer.outputSize);
+			file.read(reinterpret_cast<char*>(layer.weights.data()), layer.weights.size());
+			file.read(reinterpret_cast<char*>(layer.weightScales.data()), layer.weightScales.size() * sizeof(float));
+			file.read(reinterpret_cast<char*>(layer.biases.data()), layer.biases.size() * sizeof(float));
+			if (!file) {
+				return false;
+			}
+			layer.weightSums.resize(layer.outputSize);
+			for (uint32_t neuron = 0; neuron < layer.outputSize; ++neuron) {
+				const int8_t* row = layer.weights.data() + static_cast<size_t>(neuron) * layer.paddedInputSize;
+				layer.weightSums[neuron] = 0;
+				for (uint32_t input = 0; input < layer.inputSize; ++input) {
+					layer.weightSums[neuron] += row[input];
+				}
+			}
+		}
+		m_layers = std::move(layers);
+		return true;
+	}
+
+private:
+	struct QuantizedLayer {
+		uint32_t inputSize = 0;
+		uint32_t outputSize = 0;
+		uint32_t paddedInputSize = 0;
+		DenseActivation activation = DenseActivation::LINEAR;
+		std::vector<int8_t> weights; // row major [outputs][padded inputs]
+		std::vector<float> weightScales;
+		std::vector<int32_t> weightSums;
+		std::vector<float> biases;
+	};
+
+	std::vector<QuantizedLayer> m_layers;
+
+	void feedRow(const float* input, float* output, QuantizedBuffer& buffer) const {
+		buffer.values.assign(input, input + getInputSize());
+		for (const QuantizedLayer& layer : m_layers) {
+			const float inputScale = quantized::scaleOf(buffer.values.data(), layer.inputSize);
+			buffer.quantized.assign(layer.paddedInputSize, 0);
+			for (uint32_t i = 0; i < layer.inputSize; ++i) {
+				buffer.quantized[i] = quantized::quantize(buffer.values[i], 1.0f / inputScale);
+			}
+
+			buffer.next.resize(layer.outputSize);
+			for (uint32_t neuron = 0; neuron < layer.outputSize; ++neuron) {
+				const int32_t sum = quantized::dot(layer.weights.data() + static_cast<size_t>(neuron) * layer.paddedInputSize,
+					buffer.quantized.data(), layer.paddedInputSize, layer.weightSums[neuron]);
+				buffer.next[neuron] = DenseNetwork::activate(layer.activation,
+					sum * (layer.weightScales[neuron] * inputScale) + layer.biases[neuron]);
+			}
+			std::swap(buffer.values, buffer.next);
+		}
+		std::copy(buffer.values.begin(), buffer.values.end(), output);
+	}
+
+	template <typename T>
+	static inline void write(std::ofstream& file, const T value) {
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static inline bool read(std::ifstream& file, T& value) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+};
+
+// The accuracy check of an export, inputs is a row major [batch][input size] matrix
+inline QuantizationError measureQuantizationError(const DenseNetwork& network, const QuantizedNetwork& quantizedNetwork,
+		const float* inputs, const uint32_t batchSize) {
+	assert(network.getOutputSize() == 1 && quantizedNetwork.getOutputSize() == 1);
+	QuantizationError error;
+	DenseBuffer denseBuffer;
+	QuantizedBuffer quantizedBuffer;
+	for (uint32_t b = 0; b < batchSize; ++b) {
+		const float* input = inputs + static_cast<size_t>(b) * network.getInputSize();
+		const float expected = network.feed(input, denseBuffer);
+		const float difference = std::abs(quantizedNetwork.feed(input, quantizedBuffer) - expected);
+		error.maxError = std::max(error.maxError, difference);
+		error.meanError += difference / batchSize;
+		error.maxOutput = std::max(error.maxOutput, std::abs(expected));
+	}
+	return error;
+}
@@ -0,0 +1,290 @@
+#include "neural-net-ai/supervised-trainer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+inline float dot(const float* a, const float* b, const uint32_t size) {
+	constexpr uint32_t LANES = 8;
+	float lanes[LANES] = { };
+	uint32_t i = 0;
+	for (; i + LANES <= size; i += LANES) {
+		for (uint32_t lane = 0; lane < LANES; ++lane) {
+			lanes[lane] += a[i + lane] * b[i + lane];
+		}
+	}
+	float sum = 0.0f;
+	for (uint32_t lane = 0; lane < LANES; ++lane) {
+		sum += lanes[lane];
+	}
+	for (; i < size; ++i) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+// out += scale * values
+inline void addScaled(float* __restrict out, const float scale, const float* __restrict values, const uint32_t size) {
+	for (uint32_t i = 0; i < size; ++i) {
+		out[i] += scale * values[i];
+	}
+}
+
+}
+
+SupervisedTrainer::SupervisedTrainer(DenseNetwork* network, const FitSettings& settings)
+		: m_network(network)
+		, m_settings(settings)
+		, m_weightMoments(network->getNumOfWeights(), 0.0f)
+		, m_weightVariances(network->getNumOfWeights(), 0.0f)
+		, m_biasMoments(network->getNumOfBiases(), 0.0f)
+		, m_biasVariances(network->getNumOfBiases(), 0.0f)
+		, m_steps(0)
+		, m_workers(std::max<uint32_t>(settings.threads, 1))
+		, m_batchReady(m_workers.size())
+		, m_gradientsReady(m_workers.size())
+		, m_stepDone(m_workers.size())
+		, m_stop(false)
+		, m_train(false)
+		, m_batchRows(0) {
+	assert(network->getOutputSize() == 1 && m_settings.batchSize > 0);
+	for (uint32_t layer = 0; layer < network->getNumOfLayers(); ++layer) {
+		m_weightOffsets.push_back(network->getWeights(layer) - network->getWeights(0));
+		m_biasOffsets.push_back(network->getBiases(layer) - network->getBiases(0));
+	}
+
+	const std::vector<uint32_t>& sizes = network->getLayerSizes();
+	const uint32_t maxRows = (m_settings.batchSize + m_workers.size() - 1) / m_workers.size();
+	const uint32_t maxLayerSize = *std::max_element(sizes.begin(), sizes.end());
+	for (Worker& worker : m_workers) {
+		worker.weightGradients.resize(network->getNumOfWeights());
+		worker.biasGradients.resize(network->getNumOfBiases());
+		for (uint32_t size : sizes) {
+			worker.sums.emplace_back(static_cast<size_t>(size) * maxRows);
+			worker.values.emplace_back(static_cast<size_t>(size) * maxRows);
+		}
+		worker.deltas.resize(static_cast<size_t>(maxLayerSize) * maxRows);
+		worker.previousDeltas.resize(static_cast<size_t>(maxLayerSize) * maxRows);
+	}
+	m_inputs.resize(static_cast<size_t>(m_settings.batchSize) * network->getInputSize());
+	m_targets.resize(m_settings.batchSize);
+
+	// The calling thread is worker 0
+	for (uint32_t thread = 1; thread < m_workers.size(); ++thread) {
+		m_threads.emplace_back(&SupervisedTrainer::work, this, thread);
+	}
+}
+
+SupervisedTrainer::~SupervisedTrainer() {
+	m_stop = true;
+	m_batchReady.arrive_and_wait();
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+FitReport SupervisedTrainer::fitEpoch(PositionReader& reader) {
+	return runEpoch(reader, true);
+}
+
+FitReport SupervisedTrainer::measureLoss(PositionReader& reader) {
+	return runEpoch(reader, false);
+}
+
+FitReport SupervisedTrainer::runEpoch(PositionReader& reader, const bool train) {
+	FitReport report;
+	double loss = 0.0;
+	const uint32_t inputSize = m_network->getInputSize();
+	m_train = train;
+	m_records.resize(CHUNK_RECORDS);
+	size_t count;
+	while ((count = reader.read(m_records.data(), CHUNK_RECORDS)) > 0) {
+		if (train) {
+			for (size_t i = count - 1; i > 0; --i) {
+				std::swap(m_records[i], m_records[m_rgen.getUint32() % (i + 1)]);
+			}
+		}
+
+		for (size_t batchStart = 0; batchStart < count; batchStart += m_settings.batchSize) {
+			m_batchRows = std::min<size_t>(m_settings.batchSize, count - batchStart);
+			for (uint32_t row = 0; row < m_batchRows; ++row) {
+				const PositionRecord& record = m_records[batchStart + row];
+				const nnpp::NNPPStackVector<float> input = record.getBoard().asFloats();
+				std::copy(input.begin(), input.end(), m_inputs.begin() + static_cast<size_t>(row) * inputSize);
+				m_targets[row] = getTarget(record, m_settings);
+			}
+			runBatch();
+			for (const Worker& worker : m_workers) {
+				loss += worker.loss;
+			}
+			report.positions += m_batchRows;
+		}
+	}
+	report.meanLoss = report.positions > 0 ? static_cast<float>(loss / report.positions) : 0.0f;
+	return report;
+}
+
+void SupervisedTrainer::runBatch() {
+	if (m_train) {
+		m_steps++;
+	}
+	m_batchReady.arrive_and_wait();
+	computeGradients(0);
+	m_gradientsReady.arrive_and_wait();
+	updateSlice(0);
+	m_stepDone.arrive_and_wait();
+}
+
+void SupervisedTrainer::work(const uint32_t thread) {
+	while (true) {
+		m_batchReady.arrive_and_wait();
+		if (m_stop) {
+			return;
+		}
+		computeGradients(thread);
+		m_gradientsReady.arrive_and_wait();
+		updateSlice(thread);
+		m_stepDone.arrive_and_wait();
+	}
+}
+
+void SupervisedTrainer::computeGradients(const uint32_t thread) {
+	Worker& worker = m_workers[thread];
+	const uint32_t rowsPerThread = (m_batchRows + m_workers.size() - 1) / m_workers.size();
+	const uint32_t firstRow = std::min(thread * rowsPerThread, m_batchRows);
+	const uint32_t rows = std::min(rowsPerThread, m_batchRows - firstRow);
+	worker.loss = 0.0;
+	if (m_train) {
+		std::fill(worker.weightGradients.begin(), worker.weightGradients.end(), 0.0f);
+		std::fill(worker.biasGradients.begin(), worker.biasGradients.end(), 0.0f);
+	}
+	if (rows == 0) {
+		return;
+	}
+
+	const uint32_t inputSize = m_network->getInputSize();
+	std::copy(m_inputs.begin() + static_cast<size_t>(firstRow) * inputSize,
+		m_inputs.begin() + static_cast<size_t>(firstRow + rows) * inputSize, worker.values[0].begin());
+	forward(worker, rows);
+	if (m_train) {
+		backward(worker, firstRow, rows);
+	}
+	else {
+		const std::vector<float>& outputs = worker.values.back();
+		for (uint32_t row = 0; row < rows; ++row) {
+			const float error = outputs[row] - m_targets[firstRow + row];
+			worker.loss += error * error;
+		}
+	}
+}
+
+void SupervisedTrainer::forward(Worker& worker, const uint32_t rows) const {
+	const std::vector<uint32_t>& sizes = m_network->getLayerSizes();
+	for (uint32_t layer = 0; layer < m_network->getNumOfLayers(); ++layer) {
+		const uint32_t inputSize = sizes[layer];
+		const uint32_t outputSize = sizes[layer + 1];
+		const float* weights = m_network->getWeights(layer);
+		const float* biases = m_network->getBiases(layer);
+		const DenseActivation activation = m_network->getActivation(layer);
+		const float* inputs = worker.values[layer].data();
+		float* sums = worker.sums[layer + 1].data();
+		float* values = worker.values[layer + 1].data();
+		for (uint32_t neuron = 0; neuron < outputSize; ++neuron) {
+			const float* row = weights + static_cast<size_t>(neuron) * inputSize;
+			for (uint32_t r = 0; r < rows; ++r) {
+				const size_t index = static_cast<size_t>(r) * outputSize + neuron;
+				sums[index] = dot(row, inputs + static_cast<size_t>(r) * inputSize, inputSize) + biases[neuron];
+				values[index] = DenseNetwork::activate(activation, sums[index]);
+			}
+		}
+	}
+}
+
+void SupervisedTrainer::backward(Worker& worker, const uint32_t firstRow, const uint32_t rows) const {
+	// The loss is the mean over the whole batch, every row adds its share to the gradients of its thread
+	const std::vector<uint32_t>& sizes = m_network->getLayerSizes();
+	const float scale = 2.0f / m_batchRows;
+	const std::vector<float>& outputs = worker.values.back();
+	for (uint32_t row = 0; row < rows; ++row) {
+		const float error = outputs[row] - m_targets[firstRow + row];
+		worker.loss += error * error;
+		worker.deltas[row] = scale * error;
+	}
+
+	for (uint32_t layer = m_network->getNumOfLayers(); layer-- > 0;) {
+		const uint32_t inputSize = sizes[layer];
+		const uint32_t outputSize = sizes[layer + 1];
+		const float* weights = m_network->getWeights(layer);
+		const DenseActivation activation = m_network->getActivation(layer);
+		const float* inputs = worker.values[layer].data();
+		const float* sums = worker.sums[layer + 1].data();
+		float* weightGradients = worker.weightGradients.data() + m_weightOffsets[layer];
+		float* biasGradients = worker.biasGradients.data() + m_biasOffsets[layer];
+
+		// deltas hold the gradient of the layer outputs, after this the gradient of the sums
+		for (size_t i = 0; i < static_cast<size_t>(rows) * outputSize; ++i) {
+			worker.deltas[i] *= DenseNetwork::derivative(activation, sums[i]);
+		}
+		const bool propagate = layer > 0;
+		if (propagate) {
+			std::fill(worker.previousDeltas.begin(), worker.previousDeltas.begin() + static_cast<size_t>(rows) * inputSize, 0.0f);
+		}
+		for (uint32_t neuron = 0; neuron < outputSize; ++neuron) {
+			const float* row = weights + static_cast<size_t>(neuron) * inputSize;
+			float* rowGradients = weightGradients + static_cast<size_t>(neuron) * inputSize;
+			for (uint32_t r = 0; r < rows; ++r) {
+				const float delta = worker.deltas[static_cast<size_t>(r) * outputSize + neuron];
+				if (delta == 0.0f) {
+					continue;
+				}
+				biasGradients[neuron] += delta;
+				addScaled(rowGradients, delta, inputs + static_cast<size_t>(r) * inputSize, inputSize);
+				if (propagate) {
+					addScaled(worker.previousDeltas.data() + static_cast<size_t>(r) * inputSize, delta, row, inputSize);
+				}
+			}
+		}
+		std::swap(worker.deltas, worker.previousDeltas);
+	}
+}
+
+void SupervisedTrainer::updateSlice(const uint32_t thread) {
+	if (!m_train) {
+		return;
+	}
+	// Every thread sums the gradients of all the workers for its slice of the weights and of the biases
+	const auto slice = [&](const size_t size) {
+		const size_t perThread = (size + m_workers.size() - 1) / m_workers.size();
+		const size_t begin = std::min(thread * perThread, size);
+		return std::make_pair(begin, std::min(begin + perThread, size));
+	};
+
+	const auto [weightBegin, weightEnd] = slice(m_network->getNumOfWeights());
+	const auto [biasBegin, biasEnd] = slice(m_network->getNumOfBiases());
+	Worker& own = m_workers[thread];
+	for (uint32_t other = 0; other < m_workers.size(); ++other) {
+		if (other == thread) {
+			continue;
+		}
+		const Worker& worker = m_workers[other];
+		addScaled(own.weightGradients.data() + weightBegin, 1.0f, worker.weightGradients.data() + weightBegin, weightEnd - weightBegin);
+		addScaled(own.biasGradients.data() + biasBegin, 1.0f, worker.biasGradients.data() + biasBegin, biasEnd - biasBegin);
+	}
+	adamUpdate(m_network->getWeights(0) + weightBegin, m_weightMoments.data() + weightBegin, m_weightVariances.data() + weightBegin,
+		own.weightGradients.data() + weightBegin, weightEnd - weightBegin);
+	adamUpdate(m_network->getBiases(0) + biasBegin, m_biasMoments.data() + biasBegin, m_biasVariances.data() + biasBegin,
+		own.biasGradients.data() + biasBegin, biasEnd - biasBegin);
+}
+
+void SupervisedTrainer::adamUpdate(float* parameters, float* moments, float* variances, const float* gradients, const size_t count) const {
+	const float beta1 = m_settings.beta1;
+	const float beta2 = m_settings.beta2;
+	const float stepSize = m_settings.learningRate * std::sqrt(1.0f - std::pow(beta2, m_steps)) / (1.0f - std::pow(beta1, m_steps));
+	const float epsilon = m_settings.epsilon;
+	for (size_t i = 0; i < count; ++i) {
+		moments[i] = beta1 * moments[i] + (1.0f - beta1) * gradients[i];
+		variances[i] = beta2 * variances[i] + (1.0f - beta2) * gradients[i] * gradients[i];
+		parameters[i] -= stepSize * moments[i] / (std::sqrt(variances[i]) + epsilon);
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+struct FitSettings;
+struct FitReport;
+class SupervisedTrainer;
+
+#include "game/position-dataset.h"
+#include "neural-net-ai/analyzer-output.h"
+#include "neural-net-ai/dense-network.h"
+#include "tools/random-generator.h"
+
+#include <barrier>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct FitSettings {
+	float learningRate = 0.001f;
+	float beta1 = 0.9f;
+	float beta2 = 0.999f;
+	float epsilon = 1e-8f;
+	uint32_t batchSize = 256;
+	uint32_t threads = 1;
+	float resultWeight = 0.5f; // share of the game result in the target, the rest comes from the search score
+	float scoreScale = ANALYZER_SCORE_SCALE; // centipawns of score that give a target of tanh(1)
+};
+
+struct FitReport {
+	uint64_t positions = 0;
+	float meanLoss = 0.0f;
+};
+
+// Fits a DenseNetwork to the positions of a dataset with mini batch Adam on the mean squared error. The target
+// of a position mixes the game result and the squashed search score, both from white's point of view like the
+// analyzer output, see analyzer-output.h. The dataset is streamed in chunks that are shuffled in memory.
+// Every batch is split between the threads by rows, every thread runs the forward and backward passes of its rows
+// into its own gradients, then every thread sums one slice of the gradients and updates the slice
+class SupervisedTrainer {
+public:
+	SupervisedTrainer() = delete;
+	SupervisedTrainer(const SupervisedTrainer& other) = delete;
+	SupervisedTrainer(DenseNetwork* network, const FitSettings& settings);
+	~SupervisedTrainer();
+
+	// One pass over the records of reader, from where it is to the end
+	FitReport fitEpoch(PositionReader& reader);
+	// Loss over the records of reader without training
+	FitReport measureLoss(PositionReader& reader);
+
+	static inline float getTarget(const PositionRecord& record, const FitSettings& settings) {
+		return settings.resultWeight * record.result
+			+ (1.0f - settings.resultWeight) * std::tanh(record.score / settings.scoreScale);
+	}
+
+private:
+	static constexpr uint32_t CHUNK_RECORDS = 1 << 16; // records that are shuffled together
+
+	// What a thread keeps between batches
+	struct Worker {
+		std::vector<float> weightGradients;
+		std::vector<float> biasGradients;
+		std::vector<std::vector<float>> sums; // [layer][row][neuron] before the activation
+		std::vector<std::vector<float>> values; // [layer][row][neuron] after it, values[0] is the input
+		std::vector<float> deltas;
+		std::vector<float> previousDeltas;
+		double loss = 0.0;
+	};
+
+	DenseNetwork* m_network;
+	FitSettings m_settings;
+	std::vector<size_t> m_weightOffsets;
+	std::vector<size_t> m_biasOffsets;
+	std::vector<float> m_weightMoments;
+	std::vector<float> m_weightVariances;
+	std::vector<float> m_biasMoments;
+	std::vector<float> m_biasVariances;
+	uint64_t m_steps;
+
+	std::vector<Worker> m_workers;
+	std::vector<std::thread> m_threads;
+	std::barrier<> m_batchReady;
+	std::barrier<> m_gradientsReady;
+	std::barrier<> m_stepDone;
+	bool m_stop;
+	bool m_train; // the batch only measures the loss when false
+
+	std::vector<PositionRecord> m_records;
+	std::vector<float> m_inputs;
+	std::vector<float> m_targets;
+	uint32_t m_batchRows;
+	RandomGenerator m_rgen;
+
+	FitReport runEpoch(PositionReader& reader, bool train);
+	void runBatch();
+	void work(uint32_t thread);
+	void computeGradients(uint32_t thread);
+	void updateSlice(uint32_t thread);
+	void forward(Worker& worker, uint32_t rows) const;
+	void backward(Worker& worker, uint32_t firstRow, uint32_t rows) const;
+	void adamUpdate(float* parameters, float* moments, float* variances, const float* gradients, size_t count) const;
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "game/chess-board-structs.hpp"
+
+#include <array>
+
+namespace piecesquaretables {
+
+// Game phase is counted from the pieces left on the board, 24 is the starting position and 0 is a pawn ending
+static constexpr int32_t MAX_GAME_PHASE = 24;
+
+// Material and position values in the evaluation scale, a pawn is 10.
+// Tables are written from white's point of view with the 8th rank on top, black reads them mirrored
+typedef std::array<int8_t, BOARD_SIZE * BOARD_SIZE> SquareValues;
+
+static constexpr std::array<int16_t, NUM_OF_TYPES> MATERIAL = { 0, 10, 30, 35, 50, 100, 0 };
+static constexpr std::array<int32_t, NUM_OF_TYPES> PHASE = { 0, 0, 1, 1, 2, 4, 0 };
+
+static constexpr SquareValues PAWN_MIDGAME = {
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 5,  5,  5,  5,  5,  5,  5,  5,
+	 1,  1,  2,  3,  3,  2,  1,  1,
+	 0,  0,  1,  2,  2,  1,  0,  0,
+	 0,  0,  0,  2,  2,  0,  0,  0,
+	 0,  0, -1,  0,  0, -1,  0,  0,
+	 0,  1,  1, -2, -2,  1,  1,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr SquareValues PAWN_ENDGAME = {
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 8,  8,  8,  8,  8,  8,  8,  8,
+	 5,  5,  5,  5,  5,  5,  5,  5,
+	 3,  3,  3,  3,  3,  3,  3,  3,
+	 2,  2,  2,  2,  2,  2,  2,  2,
+	 1,  1,  1,  1,  1,  1,  1,  1,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr SquareValues KNIGHT_VALUES = {
+	-5, -4, -3, -3, -3, -3, -4, -5,
+	-4, -2,  0,  0,  0,  0, -2, -4,
+	-3,  0,  1,  2,  2,  1,  0, -3,
+	-3,  1,  2,  2,  2,  2,  1, -3,
+	-3,  0,  2,  2,  2,  2,  0, -3,
+	-3,  1,  1,  2,  2,  1,  1, -3,
+	-4, -2,  0,  1,  1,  0, -2, -4,
+	-5, -4, -3, -3, -3, -3, -4, -5,
+};
+
+static constexpr SquareValues BISHOP_VALUES = {
+	-2, -1, -1, -1, -1, -1, -1, -2,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  1,  1,  1,  1,  0, -1,
+	-1,  1,  1,  1,  1,  1,  1, -1,
+	-1,  0,  1,  1,  1,  1,  0, -1,
+	-1,  1,  1,  1,  1,  1,  1, -1,
+	-1,  1,  0,  0,  0,  0,  1, -1,
+	-2, -1, -1, -1, -1, -1, -1, -2,
+};
+
+static constexpr SquareValues ROOK_MIDGAME = {
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 1,  1,  1,  1,  1,  1,  1,  1,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	 0,  0,  0,  1,  1,  0,  0,  0,
+};
+
+static constexpr SquareValues ROOK_ENDGAME = {
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 1,  1,  1,  1,  1,  1,  1,  1,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+static constexpr SquareValues QUEEN_VALUES = {
+	-2, -1, -1,  0,  0, -1, -1, -2,
+	-1,  0,  0,  0,  0,  0,  0, -1,
+	-1,  0,  1,  1,  1,  1,  0, -1,
+	 0,  0,  1,  1,  1,  1,  0,  0,
+	 0,  0,  1,  1,  1,  1,  0,  0,
+	-1,  1,  1,  1,  1,  1,  0, -1,
+	-1,  0,  1,  0,  0,  0,  0, -1,
+	-2, -1, -1,  0,  0, -1, -1, -2,
+};
+
+static constexpr SquareValues KING_MIDGAME = {
+	-3, -4, -4, -5, -5, -4, -4, -3,
+	-3, -4, -4, -5, -5, -4, -4, -3,
+	-3, -4, -4, -5, -5, -4, -4, -3,
+	-3, -4, -4, -5, -5, -4, -4, -3,
+	-2, -3, -3, -4, -4, -3, -3, -2,
+	-1, -2, -2, -2, -2, -2, -2, -1,
+	 2,  2,  0,  0,  0,  0,  2,  2,
+	 2,  3,  1,  0,  0,  1,  3,  2,
+};
+
+static constexpr SquareValues KING_ENDGAME = {
+	-5, -4, -3, -2, -2, -3, -4, -5,
+	-3, -2, -1,  0,  0, -1, -2, -3,
+	-3, -1,  2,  3,  3,  2, -1, -3,
+	-3, -1,  3,  4,  4,  3, -1, -3,
+	-3, -1,  3,  4,  4,  3, -1, -3,
+	-3, -1,  2,  3,  3,  2, -1, -3,
+	-3, -3,  0,  0,  0,  0, -3, -3,
+	-5, -3, -3, -3, -3, -3, -3, -5,
+};
+
+// Material plus position for every piece on every square, signed by color so the board can keep plain sums.
+// Empty tiles are worth nothing so a tile change is always: score -= old value, score += new value
+class PieceSquareTable {
+public:
+	constexpr PieceSquareTable()
+			: m_midgame(createTable(true))
+			, m_endgame(createTable(false)) {
+	}
+
+	constexpr int16_t getMidgameValue(const BoardTile tile, const TileCoords coords) const {
+		return m_midgame[tableIndex(tile)][coords.asIndex()];
+	}
+
+	constexpr int16_t getEndgameValue(const BoardTile tile, const TileCoords coords) const {
+		return m_endgame[tableIndex(tile)][coords.asIndex()];
+	}
+
+	constexpr int32_t getPhaseValue(const BoardTile tile) const {
+		return PHASE[tile.type];
+	}
+
+private:
+	typedef std::array<std::array<int16_t, BOARD_SIZE * BOARD_SIZE>, 2 * NUM_OF_TYPES> Table;
+
+	Table m_midgame;
+	Table m_endgame;
+
+	static constexpr uint32_t tableIndex(const BoardTile tile) {
+		return static_cast<uint32_t>(tile.color) * NUM_OF_TYPES + tile.type;
+	}
+
+	static constexpr int8_t squareValue(const TileType type, const bool isMidgame, const uint32_t square) {
+		switch (type) {
+		case PAWN:		return isMidgame ? PAWN_MIDGAME[square] : PAWN_ENDGAME[square];
+		case KNIGHT:	return KNIGHT_VALUES[square];
+		case BISHOP:	return BISHOP_VALUES[square];
+		case ROOK:		return isMidgame ? ROOK_MIDGAME[square] : ROOK_ENDGAME[square];
+		case QUEEN:		return QUEEN_VALUES[square];
+		case KING:		return isMidgame ? KING_MIDGAME[square] : KING_ENDGAME[square];
+		default:		return 0;
+		}
+	}
+
+	static constexpr Table createTable(const bool isMidgame) {
+		Table table = { };
+		for (uint8_t type = PAWN; type < NUM_OF_TYPES; ++type) {
+			for (uint8_t y = 0; y < BOARD_SIZE; ++y) {
+				for (uint8_t x = 0; x < BOARD_SIZE; ++x) {
+					const uint32_t square = y * BOARD_SIZE + x;
+					const int16_t white = MATERIAL[type] + squareValue(static_cast<TileType>(type), isMidgame, (BOARD_SIZE - 1 - y) * BOARD_SIZE + x);
+					const int16_t black = MATERIAL[type] + squareValue(static_cast<TileType>(type), isMidgame, y * BOARD_SIZE + x);
+					table[static_cast<uint32_t>(WHITE) * NUM_OF_TYPES + type][square] = white;
+					table[static_cast<uint32_t>(BLACK) * NUM_OF_TYPES + type][square] = -black;
+				}
+			}
+		}
+		return table;
+	}
+};
+
+static constexpr PieceSquareTable PIECE_SQUARE_TABLE = { };
+
+}
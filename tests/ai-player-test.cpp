@@ -1,15 +1,302 @@
 #include "neural-net-ai/nnai-player.h"
 #include "neural-net-ai/cai-population.h"
 #include "neural-net-ai/nnai-trainer.h"
+#include "neural-net-ai/inference-batcher.h"
+#include "neural-net-ai/packed-network.h"
+#include "neural-net-ai/quantized-network.h"
+#include "neural-net-ai/supervised-trainer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <optional>
+#include <thread>
 
 int main() {
 	NNAI ai(0, CAI_LAYERS);
 	auto neuronBuffer = nnpp::allocNeuronBuffer<float>();
 	ai.initRandomUniform(-1.0f, 1.0f);
-	NNAIPlayer aiPlayer(Color::WHITE, &ai, &neuronBuffer);
+	NNAIPlayer aiPlayer(Color::WHITE, &ai);
 	ChessBoard board;
 	BoardMove m;
 
+	{
+		// With an nnpp that has weight accessors the copy of the analyzer gives the same values as nnpp, so the player
+		// does not fall back to feedAt. With any other nnpp the player evaluates with feedAt
+		const std::optional<DenseNetwork> copy = toDenseNetwork(ai, ANALYZER_NETWORK_INDEX);
+		assert(aiPlayer.usesCompiledAnalyzer() == copy.has_value());
+		if (copy) {
+			const DenseNetwork& analyzer = *copy;
+			DenseBuffer denseBuffer;
+			const char* fens[] = {
+				"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+				"rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+				"6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+				"8/8/4k3/8/2Q5/8/8/4K3 b - - 0 1",
+			};
+			for (const char* fen : fens) {
+				const nnpp::NNPPStackVector<float> input = ChessBoard(fen).asFloats();
+				const float expected = ai.feedAt(ANALYZER_NETWORK_INDEX, input, neuronBuffer)[0];
+				assert(std::abs(analyzer.feed(&input[0], denseBuffer) - expected) <= 1e-3f * std::max(1.0f, std::abs(expected)));
+			}
+			assert(analyzerMatchesNNPP(ai, analyzer));
+
+			RandomGenerator rgen(3);
+			DenseNetwork other(analyzer);
+			other.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+			assert(!analyzerMatchesNNPP(ai, other));
+		}
+	}
+
+	{
+		// A batch gives exactly the values of single feeds, for any batch size
+		RandomGenerator rgen(7);
+		DenseNetwork network({ 64, 100, 37, 9, 1 }, DenseActivation::LEAKY_RELU);
+		network.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		const uint32_t batchSize = 11;
+		std::vector<float> inputs(batchSize * network.getInputSize());
+		for (float& input : inputs) {
+			input = rgen.get(-10.0f, 10.0f);
+		}
+		std::vector<float> outputs(batchSize);
+		DenseBuffer denseBuffer;
+		network.feedBatch(inputs.data(), batchSize, outputs.data(), denseBuffer);
+		for (uint32_t i = 0; i < batchSize; ++i) {
+			assert(network.feed(&inputs[i * network.getInputSize()], denseBuffer) == outputs[i]);
+		}
+	}
+
+	{
+		// Accumulators updated move by move match full refreshes, and the rest of the network gives the value of a full pass from them
+		RandomGenerator rgen(11);
+		DenseNetwork network({ 64, 48, 16, 1 }, DenseActivation::RELU);
+		network.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		const FirstLayerColumns firstLayer(network);
+		DenseBuffer denseBuffer;
+		NetworkAccumulator accumulator;
+		NetworkAccumulator updated;
+		NetworkAccumulator refreshed;
+		for (uint32_t game = 0; game < 20; ++game) {
+			ChessBoard position;
+			firstLayer.refresh(position, accumulator);
+			for (uint32_t ply = 0; ply < 200 && !position.isDraw(); ++ply) {
+				MovesVector moves;
+				position.getNextPlayerMoves(moves);
+				if (moves.empty()) {
+					break;
+				}
+				const ChessBoard parent(position);
+				const BoardMove move = moves[rgen.getUint32() % moves.size()];
+				position.playMove(move);
+				firstLayer.update(accumulator, parent, move, position, updated);
+				firstLayer.refresh(position, refreshed);
+				for (uint32_t i = 0; i < firstLayer.getNumOfNeurons(); ++i) {
+					assert(std::abs(updated.sums[i] - refreshed.sums[i]) <= 1e-3f);
+				}
+				std::swap(accumulator, refreshed);
+			}
+			const nnpp::NNPPStackVector<float> input = position.asFloats();
+			float output;
+			network.feedBatchFromFirstLayer(accumulator.sums.data(), 1, &output, denseBuffer);
+			assert(std::abs(output - network.feed(&input[0], denseBuffer)) <= 1e-3f);
+		}
+
+		// Random games rarely castle or take en passant, every move of these positions is checked
+		for (const char* fen : { "r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1", "r3k2r/8/8/8/3Pp3/8/8/R3K2R b KQkq d3 0 1" }) {
+			const ChessBoard parent(fen);
+			firstLayer.refresh(parent, accumulator);
+			MovesVector moves;
+			parent.getNextPlayerMoves(moves);
+			for (const BoardMove& move : moves) {
+				ChessBoard position(parent);
+				position.playMove(move);
+				firstLayer.update(accumulator, parent, move, position, updated);
+				firstLayer.refresh(position, refreshed);
+				for (uint32_t i = 0; i < firstLayer.getNumOfNeurons(); ++i) {
+					assert(std::abs(updated.sums[i] - refreshed.sums[i]) <= 1e-3f);
+				}
+			}
+		}
+	}
+
+	{
+		// The packed network gives the values of the DenseNetwork it was compiled from, for any batch size.
+		// A row gets exactly the same value alone as in a batch
+		RandomGenerator rgen(9);
+		DenseNetwork network({ 64, 300, 37, 20, 1 }, DenseActivation::LEAKY_RELU);
+		network.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		const PackedNetwork packedNetwork(network);
+		const uint32_t batchSize = 11;
+		std::vector<float> inputs(batchSize * network.getInputSize());
+		for (float& input : inputs) {
+			input = rgen.get(-10.0f, 10.0f);
+		}
+		std::vector<float> outputs(batchSize);
+		std::vector<float> packedOutputs(batchSize);
+		DenseBuffer denseBuffer;
+		PackedBuffer packedBuffer;
+		network.feedBatch(inputs.data(), batchSize, outputs.data(), denseBuffer);
+		packedNetwork.feedBatch(inputs.data(), batchSize, packedOutputs.data(), packedBuffer);
+		for (uint32_t i = 0; i < batchSize; ++i) {
+			const float tolerance = 1e-4f * std::max(1.0f, std::abs(outputs[i]));
+			assert(std::abs(packedOutputs[i] - outputs[i]) <= tolerance);
+			assert(packedNetwork.feed(&inputs[i * network.getInputSize()], packedBuffer) == packedOutputs[i]);
+		}
+	}
+
+	{
+		// Networks compiled with a pool share the layers they have in common and keep their own values
+		RandomGenerator rgen(13);
+		DenseNetwork parent({ 64, 200, 100, 1 }, NNPP_HIDDEN_ACTIVATION);
+		parent.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		DenseNetwork child(parent);
+		child.getWeights(2)[5] += 0.1f;
+		LayerPool pool;
+		const PackedNetwork packedParent(parent, &pool);
+		const size_t parentBytes = pool.getUniqueBytes();
+		const PackedNetwork packedChild(child, &pool);
+		assert(pool.getUniqueBytes() > parentBytes && pool.getUniqueBytes() < parentBytes * 3 / 2);
+
+		const ChessBoard position("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10");
+		const nnpp::NNPPStackVector<float> input = position.asFloats();
+		DenseBuffer denseBuffer;
+		PackedBuffer packedBuffer;
+		for (const auto& [network, packedNetwork] : { std::pair(&parent, &packedParent), std::pair(&child, &packedChild) }) {
+			const float expected = network->feed(&input[0], denseBuffer);
+			assert(std::abs(packedNetwork->feed(&input[0], packedBuffer) - expected) <= 1e-4f * std::max(1.0f, std::abs(expected)));
+		}
+	}
+
+	{
+		// Inputs of many threads go through the batcher in batches and get the values of single feeds
+		RandomGenerator rgen(17);
+		DenseNetwork network({ 64, 120, 30, 1 }, NNPP_HIDDEN_ACTIVATION);
+		network.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		const auto packedNetwork = std::make_shared<const PackedNetwork>(network);
+		const uint32_t numOfThreads = 8;
+		const uint32_t evaluationsPerThread = 50;
+		std::vector<float> inputs(numOfThreads * evaluationsPerThread * network.getInputSize());
+		for (float& input : inputs) {
+			input = rgen.get(-10.0f, 10.0f);
+		}
+		std::vector<float> outputs(numOfThreads * evaluationsPerThread);
+		InferenceBatcher batcher(packedNetwork, numOfThreads);
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < numOfThreads; ++t) {
+			threads.emplace_back([&, t]() {
+				for (uint32_t i = t * evaluationsPerThread; i < (t + 1) * evaluationsPerThread; ++i) {
+					outputs[i] = batcher.evaluate(&inputs[i * network.getInputSize()]);
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		PackedBuffer packedBuffer;
+		for (uint32_t i = 0; i < outputs.size(); ++i) {
+			const float expected = packedNetwork->feed(&inputs[i * network.getInputSize()], packedBuffer);
+			assert(std::abs(outputs[i] - expected) <= 1e-4f * std::max(1.0f, std::abs(expected)));
+		}
+		assert(batcher.getRequests() == outputs.size() && batcher.getBatches() < outputs.size());
+		std::cout << "Batches: " << batcher.getBatches() << ", evaluations: " << batcher.getRequests() << '\n';
+	}
+
+	{
+		// The int8 dot product of the compiled kernel is exact
+		RandomGenerator rgen(5);
+		const uint32_t size = quantized::paddedSize(300);
+		std::vector<int8_t> weights(size);
+		std::vector<int8_t> inputs(size);
+		int32_t weightSum = 0;
+		int32_t expected = 0;
+		for (uint32_t i = 0; i < size; ++i) {
+			weights[i] = static_cast<int8_t>(static_cast<int32_t>(rgen.getUint32() % 255) - quantized::MAX_VALUE);
+			inputs[i] = static_cast<int8_t>(static_cast<int32_t>(rgen.getUint32() % 255) - quantized::MAX_VALUE);
+			weightSum += weights[i];
+			expected += static_cast<int32_t>(weights[i]) * inputs[i];
+		}
+		assert(quantized::dot(weights.data(), inputs.data(), size, weightSum) == expected);
+	}
+
+	{
+		// The quantized network stays close to the float one and is saved and loaded without changes
+		RandomGenerator rgen(3);
+		DenseNetwork network({ 64, 200, 120, 60, 1 }, NNPP_HIDDEN_ACTIVATION);
+		network.initRandomUniform(MIN_AI_WEIGHT_VALUE, MAX_AI_WEIGHT_VALUE, rgen);
+		const QuantizedNetwork quantizedNetwork(network);
+		assert(quantizedNetwork.getWeightBytes() < network.getNumOfWeights() * sizeof(float) / 2);
+
+		std::vector<float> inputs;
+		ChessBoard position;
+		for (uint32_t i = 0; i < 64; ++i) {
+			MovesVector moves;
+			position.getNextPlayerMoves(moves);
+			if (moves.empty() || position.isDraw()) {
+				position = ChessBoard();
+				position.getNextPlayerMoves(moves);
+			}
+			position.playMove(moves[rgen.getUint32() % moves.size()]);
+			const nnpp::NNPPStackVector<float> values = position.asFloats();
+			inputs.insert(inputs.end(), values.begin(), values.end());
+		}
+		const QuantizationError error = measureQuantizationError(network, quantizedNetwork, inputs.data(), 64);
+		assert(error.maxError <= 0.05f * error.maxOutput);
+
+		QuantizedNetwork loaded;
+		const bool isSaved = quantizedNetwork.saveToDisk("ai-test.caiq");
+		const bool isLoaded = loaded.loadFromDisk("ai-test.caiq");
+		assert(isSaved && isLoaded);
+		QuantizedBuffer quantizedBuffer;
+		for (uint32_t i = 0; i < 64; ++i) {
+			const float* input = &inputs[i * network.getInputSize()];
+			assert(loaded.feed(input, quantizedBuffer) == quantizedNetwork.feed(input, quantizedBuffer));
+		}
+		std::remove("ai-test.caiq");
+
+		// A player on the quantized network takes the move with the best quantized value
+		NNAIPlayer quantizedPlayer(Color::BLACK, std::make_shared<const QuantizedNetwork>(quantizedNetwork));
+		const ChessBoard blackToMove("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 3 3");
+		MovesVector moves;
+		blackToMove.getNextPlayerMoves(moves);
+		float bestEval = std::numeric_limits<float>::max();
+		for (const BoardMove move : moves) {
+			ChessBoard next(blackToMove);
+			next.playMove(move);
+			bestEval = std::min(bestEval, quantizedNetwork.feed(&next.asFloats()[0], quantizedBuffer));
+		}
+		BoardMove move;
+		const MoveResult result = quantizedPlayer.getMove(blackToMove, &move);
+		assert(result == MoveResult::MOVE_OK);
+		ChessBoard next(blackToMove);
+		next.playMove(move);
+		assert(quantizedNetwork.feed(&next.asFloats()[0], quantizedBuffer) == bestEval);
+	}
+
+	{
+		// A player with a cache plays the moves of one without, a position seen before needs no inference
+		// and a new version of the network empties the cache
+		NNAIEvaluationCache cache;
+		NNAIPlayer cachedPlayer(Color::WHITE, &ai, &cache);
+		const ChessBoard position("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10");
+		MovesVector moves;
+		position.getNextPlayerMoves(moves);
+		BoardMove cachedMove;
+		MoveResult result = aiPlayer.getMove(position, &m);
+		assert(result == MoveResult::MOVE_OK);
+		result = cachedPlayer.getMove(position, &cachedMove);
+		assert(result == MoveResult::MOVE_OK && cachedMove == m);
+		assert(cache.getHits() == 0 && cache.getMisses() == moves.size());
+		result = cachedPlayer.getMove(position, &cachedMove);
+		assert(result == MoveResult::MOVE_OK && cachedMove == m);
+		assert(cache.getHits() == moves.size());
+		cache.validate(1);
+		assert(cache.getHits() == 0 && cache.getMisses() == 0);
+		float evaluation;
+		ChessBoard next(position);
+		next.playMove(m);
+		assert(!cache.probe(next.getHash(), evaluation));
+	}
+
 	{
 		board.printBoard();
 		assert(aiPlayer.getMove(board, &m) == MoveResult::MOVE_OK);
@@ -25,6 +312,93 @@ int main() {
 		std::cout << '\n';
 	}
 
+	{
+		// Positions of random games go through a dataset file unchanged, and a network fitted to them learns the material balance
+		RandomGenerator rgen(21);
+		std::vector<PositionRecord> records;
+		ChessBoard position;
+		for (uint32_t i = 0; i < 4096; ++i) {
+			MovesVector moves;
+			position.getNextPlayerMoves(moves);
+			if (moves.empty() || position.isDraw()) {
+				position = ChessBoard();
+				position.getNextPlayerMoves(moves);
+			}
+			position.playMove(moves[rgen.getUint32() % moves.size()]);
+			const nnpp::NNPPStackVector<float> input = position.asFloats();
+			float material = 0.0f;
+			for (uint32_t square = 0; square < input.size(); ++square) {
+				material += input[square];
+			}
+			records.emplace_back(position, static_cast<int16_t>(material * 100.0f), material > 0.0f ? 1 : (material < 0.0f ? -1 : 0));
+		}
+
+		PositionWriter writer;
+		const bool isWriterOpen = writer.open("fit-test.caid");
+		assert(isWriterOpen);
+		writer.write(records.data(), records.size());
+		assert(writer.getWritten() == records.size());
+		const bool isClosed = writer.close();
+		assert(isClosed);
+
+		PositionReader reader;
+		const bool isReaderOpen = reader.open("fit-test.caid");
+		assert(isReaderOpen);
+		std::vector<PositionRecord> read(records.size() + 1);
+		const size_t readCount = reader.read(read.data(), read.size());
+		assert(readCount == records.size());
+		for (uint32_t i = 0; i < records.size(); ++i) {
+			assert(read[i].getBoard() == records[i].getBoard());
+			assert(read[i].score == records[i].score && read[i].result == records[i].result);
+		}
+
+		DenseNetwork network({ 64, 64, 32, 1 }, DenseActivation::RELU);
+		network.initHeUniform(rgen);
+		FitSettings settings;
+		settings.threads = 3;
+		settings.batchSize = 128;
+		SupervisedTrainer trainer(&network, settings);
+		reader.rewind();
+		const float initialLoss = trainer.measureLoss(reader).meanLoss;
+		for (uint32_t epoch = 0; epoch < 20; ++epoch) {
+			reader.rewind();
+			const FitReport report = trainer.fitEpoch(reader);
+			assert(report.positions == records.size());
+		}
+		reader.rewind();
+		const float loss = trainer.measureLoss(reader).meanLoss;
+		assert(loss < initialLoss * 0.2f);
+
+		const bool isSaved = network.saveToDisk("fit-test.cain");
+		assert(isSaved);
+		DenseNetwork loaded;
+		const bool isLoaded = loaded.loadFromDisk("fit-test.cain");
+		assert(isLoaded);
+		assert(loaded.getLayerSizes() == network.getLayerSizes());
+		DenseBuffer denseBuffer;
+		const nnpp::NNPPStackVector<float> input = records[7].getBoard().asFloats();
+		assert(loaded.feed(&input[0], denseBuffer) == network.feed(&input[0], denseBuffer));
+
+		// A player of the loaded analyzer takes the free queen on h4
+		NNAIPlayer fittedPlayer(Color::WHITE, std::make_shared<const CompiledAnalyzer>(loaded, nullptr));
+		BoardMove move;
+		const MoveResult result = fittedPlayer.getMove(ChessBoard("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"), &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 7, 3));
+
+		// The trees read the output back in tenths of a pawn, a queen up is worth more than the pawn of a target of 1
+		FitSettings scoreOnly;
+		scoreOnly.resultWeight = 0.0f;
+		const PositionRecord pawnUp(ChessBoard(), 100, 0);
+		assert(std::abs(analyzerOutputToEvaluation(SupervisedTrainer::getTarget(pawnUp, scoreOnly)) - 10.0f) < 0.1f);
+		ChessBoard queenUp("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		queenUp.playMove(BoardMove(5, 2, 7, 3));
+		const nnpp::NNPPStackVector<float> queenUpInput = queenUp.asFloats();
+		assert(analyzerOutputToEvaluation(loaded.feed(&queenUpInput[0], denseBuffer)) > 30.0f);
+		std::remove("fit-test.caid");
+		std::remove("fit-test.cain");
+	}
+
 	{
 		std::unique_ptr<CAIPopulation> pop = createCAIPopulation("ai-test.cai", 150);
 		NNAITrainer trainer(13, 4, pop.get());
@@ -0,0 +1,75 @@
+#include "game/async-game.h"
+#include "game/game-scheduler.h"
+#include "neural-net-ai/async-nnai-player.h"
+#include "neural-net-ai/nnai-player.h"
+
+#include <memory>
+#include <vector>
+
+int main() {
+	// A random analyzer of the population's shape, built directly so the test does not need nnpp to copy one
+	const std::vector<uint>& layerSizes = CAI_LAYERS[ANALYZER_NETWORK_INDEX];
+	DenseNetwork network(std::vector<uint32_t>(layerSizes.begin(), layerSizes.end()), NNPP_HIDDEN_ACTIVATION);
+	RandomGenerator weightsRgen(3);
+	network.initRandomUniform(-1.0f, 1.0f, weightsRgen);
+	const std::shared_ptr<const CompiledAnalyzer> analyzer = std::make_shared<const CompiledAnalyzer>(network, nullptr);
+
+	// Start positions a few random moves into the game, so the games differ
+	const uint32_t numOfGames = 64;
+	std::vector<ChessBoard> starts;
+	RandomGenerator rgen(5);
+	for (uint32_t game = 0; game < numOfGames; ++game) {
+		ChessBoard board;
+		for (uint32_t ply = 0; ply < 6; ++ply) {
+			MovesVector moves;
+			board.getNextPlayerMoves(moves);
+			board.playMove(moves[rgen.getUint32() % moves.size()]);
+		}
+		starts.push_back(board);
+	}
+
+	{
+		// Games on the scheduler end like the same games played one by one, and the moves of different games share batches.
+		// A row gets exactly the same value in any batch, so the games can be compared move for move
+		GameScheduler scheduler(4);
+		AnalyzerBatchQueue queue(analyzer, &scheduler);
+		std::vector<std::unique_ptr<AsyncNNAIPlayer>> players;
+		std::vector<std::unique_ptr<AsyncGame>> games;
+		std::vector<GameResult> results(numOfGames);
+		for (uint32_t game = 0; game < numOfGames; ++game) {
+			AsyncNNAIPlayer* white = players.emplace_back(std::make_unique<AsyncNNAIPlayer>(Color::WHITE, &queue)).get();
+			AsyncNNAIPlayer* black = players.emplace_back(std::make_unique<AsyncNNAIPlayer>(Color::BLACK, &queue)).get();
+			AsyncGame* asyncGame = games.emplace_back(std::make_unique<AsyncGame>(starts[game], white, black, 60)).get();
+			scheduler.spawn(asyncGame->play(), &results[game]);
+		}
+		scheduler.run();
+
+		for (uint32_t game = 0; game < numOfGames; ++game) {
+			NNAIPlayer white(Color::WHITE, analyzer);
+			NNAIPlayer black(Color::BLACK, analyzer);
+			Game g(starts[game], &white, &black, 60, false);
+			const GameResult result = g.start(false);
+			assert(result == results[game]);
+			assert(games[game]->getNumMovesPlayed() > 0);
+		}
+		assert(queue.getRequests() > 0);
+		assert(queue.getBatches() < queue.getRequests() / 8);
+	}
+
+	{
+		// Players that never suspend play on the scheduler too
+		GameScheduler scheduler(2);
+		AnalyzerBatchQueue queue(analyzer, &scheduler);
+		AsyncNNAIPlayer aiPlayer(Color::WHITE, &queue);
+		RandomPlayer random(Color::BLACK);
+		SyncPlayer randomPlayer(&random);
+		AsyncGame game(ChessBoard(), &aiPlayer, &randomPlayer, 80);
+		GameResult result = GameResult::WHITE_WINS_TIME;
+		scheduler.spawn(game.play(), &result);
+		scheduler.run();
+		assert(result != GameResult::WHITE_WINS_TIME && result != GameResult::BLACK_WINS_TIME);
+		assert(queue.getBatches() == queue.getRequests());
+	}
+
+	return 0;
+}
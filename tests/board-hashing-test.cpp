@@ -20,11 +20,22 @@ int main() {
 		}
 		board.playMove(moves[rgen.getUint32() % moves.size()]);
 		uint64_t currentHash = board.getHash();
+		uint64_t currentPawnHash = board.getPawnHash();
 		board.calculateHashFromCurrentState();
-		if (currentHash != board.getHash()) {
+		if (currentHash != board.getHash() || currentPawnHash != board.getPawnHash()) {
 			std::cout << "Test failed!" << '\n';
 			exit(0);
 		}
+
+		// The material and piece-square scores are kept the same way as the hash
+		const int16_t midgameScore = board.getMidgameScore();
+		const int16_t endgameScore = board.getEndgameScore();
+		const uint8_t gamePhase = board.getGamePhase();
+		board.calculateScoresFromCurrentState();
+		if (midgameScore != board.getMidgameScore() || endgameScore != board.getEndgameScore() || gamePhase != board.getGamePhase()) {
+			std::cout << "Score test failed!" << '\n';
+			exit(0);
+		}
 		std::cout << "\rTests done: " << (i + 1) << " out of " << TEST_RUNS;
 	}
 	std::cout << "\nDone! All tests passed! Times reset: " << timesReseted << '\n';
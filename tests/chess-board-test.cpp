@@ -3,6 +3,7 @@
 int main() {
 	ChessBoard board;
 	board.printBoard();
+	assert(board.getMidgameScore() == 0 && board.getEndgameScore() == 0 && board.getGamePhase() == 24);
 	MovesVector moves;
 	board.getMoves(WHITE, moves);
 	assert(moves.size() == 20);
@@ -0,0 +1,45 @@
+#include "mcts-ai/mcts-player.h"
+
+#include <iostream>
+
+int main() {
+	{
+		// Free queen on h4, the knight should take it
+		ChessBoard board("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		MCTSOptions options;
+		options.seed = 1;
+		MCTSPlayer mctsPlayer(board.getNextPlayerColor(), true, 2, MaterialLeafEvaluator(), options);
+		BoardMove move;
+		const MoveResult result = mctsPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 7, 3));
+		assert(mctsPlayer.getRootVisits() == MCTSOptions().simulations);
+	}
+	{
+		// Mate in one, a finished game is scored by the tree for every leaf evaluator.
+		// The playouts are random, one thread with a fixed seed plays the same ones on every run
+		ChessBoard board("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 3");
+		MCTSOptions options;
+		options.simulations = 2000;
+		options.seed = 1;
+		MCTSPlayer<PlayoutLeafEvaluator> mctsPlayer(board.getNextPlayerColor(), false, 1, PlayoutLeafEvaluator(), options);
+		BoardMove move;
+		const MoveResult result = mctsPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 5, 6));
+	}
+	{
+		// A small pool fills up, the search still finishes with the nodes it has
+		ChessBoard board;
+		MCTSOptions options;
+		options.poolNodes = 1000;
+		options.seed = 1;
+		MCTSPlayer mctsPlayer(board.getNextPlayerColor(), false, 4, MaterialLeafEvaluator(), options);
+		BoardMove move;
+		const MoveResult result = mctsPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(mctsPlayer.getTreeSize() <= options.poolNodes);
+		assert(mctsPlayer.getRootVisits() == options.simulations);
+	}
+	return 0;
+}
@@ -1,11 +1,63 @@
 #include "min-max-ai/min-max-ai-player.h"
+#include "min-max-ai/mate-solver.hpp"
+#include "min-max-ai/self-play-generator.h"
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 
 const uint32_t TESTS = 100;
 
 int main() {
+	{
+		// Every searched position of the games is in the dataset, labeled with the result of its game
+		SelfPlaySettings settings;
+		settings.games = 6;
+		settings.threads = 3;
+		settings.searchDepth = 2;
+		settings.maxPlies = 60;
+		const SelfPlayReport report = generateSelfPlayDataset("self-play-test.caid", settings);
+		assert(report.written && report.games == settings.games);
+		assert(report.positions > 0 && report.positions <= settings.games * (settings.maxPlies - settings.randomOpeningPlies));
+
+		PositionReader reader;
+		const bool isOpen = reader.open("self-play-test.caid");
+		assert(isOpen);
+		std::vector<PositionRecord> records(report.positions + 1);
+		const size_t read = reader.read(records.data(), records.size());
+		assert(read == report.positions);
+		for (uint32_t i = 0; i < report.positions; ++i) {
+			assert(records[i].result >= -1 && records[i].result <= 1);
+			MovesVector moves;
+			records[i].getBoard().getNextPlayerMoves(moves);
+			assert(!moves.empty());
+		}
+		std::remove("self-play-test.caid");
+	}
+
+	{
+		// Scores are stored in centipawns, a queen up is worth about 900
+		SelfPlaySettings settings;
+		settings.games = 1;
+		settings.searchDepth = 2;
+		settings.randomOpeningPlies = 0;
+		settings.maxPlies = 1;
+		settings.startPosition = "rnb1kbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+		const SelfPlayReport report = generateSelfPlayDataset("self-play-score-test.caid", settings);
+		assert(report.written && report.positions == 1);
+
+		PositionReader reader;
+		const bool isOpen = reader.open("self-play-score-test.caid");
+		assert(isOpen);
+		PositionRecord record;
+		const size_t read = reader.read(&record, 1);
+		assert(read == 1);
+		assert(record.getBoard() == ChessBoard(settings.startPosition));
+		assert(record.score > 700 && record.score < 1200);
+		std::remove("self-play-score-test.caid");
+	}
+
 	{
 		ChessBoard board("r1bqkbnr/1ppppQpp/2n5/p7/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4");
 		MovesVector moves;
@@ -19,11 +71,207 @@ int main() {
 		assert(evaluate(board, moves) == CHESS_BOARD_MIN_EVALUATION);
 	}
 
+	{
+		// Free queen on h4, the knight should take it
+		ChessBoard board("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		MinMaxAiPlayer minMaxPlayer(board.getNextPlayerColor(), true);
+		BoardMove move;
+		const MoveResult result = minMaxPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 7, 3));
+
+		const SearchStats& stats = minMaxPlayer.getSearchStats();
+		assert(stats.nodes > 0 && stats.quiescenceNodes < stats.nodes);
+		assert(stats.iterationNodes.size() == stats.depth);
+		assert(stats.memoHits <= stats.memoProbes && stats.firstMoveCutoffs <= stats.cutoffs);
+	}
+
+	{
+		// The search never reaches its depth, the move comes from the last iteration that finished in time
+		ChessBoard board;
+		MinMaxAiPlayer player(WHITE, false);
+		player.setSearchDepth(30);
+		player.setMoveTime(std::chrono::milliseconds(50));
+		BoardMove move;
+		const MoveResult result = player.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		MovesVector moves;
+		board.getNextPlayerMoves(moves);
+		assert(std::find(moves.begin(), moves.end(), move) != moves.end());
+		assert(player.getSearchStats().depth < 30);
+	}
+
+	{
+		// After its move the player searches the position after the reply it expects. When that reply is played
+		// the move comes from the ponder search, any other reply gets a new search
+		for (const bool playExpectedReply : { true, false }) {
+			ChessBoard board;
+			MinMaxAiPlayer player(WHITE, false);
+			player.setSearchDepth(4);
+			player.setPondering(true);
+			BoardMove move;
+			MoveResult result = player.getMove(board, &move);
+			assert(result == MoveResult::MOVE_OK);
+			assert(!player.isLastMovePonderHit());
+			board.playMove(move);
+
+			const BoardMove expectedReply = player.getExpectedReply();
+			assert(expectedReply.isValid());
+			MovesVector replies;
+			board.getNextPlayerMoves(replies);
+			const BoardMove reply = playExpectedReply ? expectedReply
+				: *std::find_if(replies.begin(), replies.end(), [&](const BoardMove m) { return m != expectedReply; });
+			board.playMove(reply);
+
+			result = player.getMove(board, &move);
+			assert(result == MoveResult::MOVE_OK);
+			assert(player.isLastMovePonderHit() == playExpectedReply);
+			MovesVector moves;
+			board.getNextPlayerMoves(moves);
+			assert(std::find(moves.begin(), moves.end(), move) != moves.end());
+			assert(player.getSearchStats().depth == 4);
+			player.setPondering(false);
+			assert(!player.getExpectedReply().isValid());
+		}
+	}
+
+	{
+		// A small memo still finds the capture, and a player whose tables were emptied searches like a new one
+		ChessBoard board("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		MinMaxAiPlayer reused(board.getNextPlayerColor(), false);
+		reused.setMemoSize(1);
+		BoardMove move;
+		const MoveResult result = reused.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 7, 3));
+
+		const ChessBoard other("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		reused.clearTables();
+		const int16_t reusedEval = reused.analyze(other)[0].evaluation;
+		MinMaxAiPlayer fresh(other.getNextPlayerColor(), false);
+		fresh.setMemoSize(1);
+		assert(fresh.analyze(other)[0].evaluation == reusedEval);
+	}
+	{
+		// Symmetric pawns cancel out, a lone passed pawn is worth more than a blocked one
+		assert(pawnstructure::evaluatePawnStructure(ChessBoard()).midgame == 0);
+		assert(pawnstructure::evaluatePawnStructure(ChessBoard()).endgame == 0);
+		const PawnStructureScores passed = pawnstructure::evaluatePawnStructure(ChessBoard("4k3/8/8/3P4/8/8/8/4K3 w - - 0 1"));
+		const PawnStructureScores blocked = pawnstructure::evaluatePawnStructure(ChessBoard("4k3/8/3p4/3P4/8/8/8/4K3 w - - 0 1"));
+		assert(passed.endgame > 0 && blocked.endgame == 0);
+		const PawnStructureScores doubled = pawnstructure::evaluatePawnStructure(ChessBoard("4k3/pp6/8/8/8/P7/P7/4K3 w - - 0 1"));
+		assert(doubled.midgame < 0 && doubled.endgame < 0);
+
+		PawnHashTable pawnHashTable(64);
+		const ChessBoard board("4k3/pp6/8/8/8/P7/P7/4K3 w - - 0 1");
+		assert(pawnHashTable.getScores(board).endgame == doubled.endgame);
+		assert(pawnHashTable.getScores(board).endgame == doubled.endgame);
+	}
+	{
+		EvaluationCache cache(1024);
+		const uint64_t hash = ChessBoard().getHash();
+		int16_t evaluation = 0;
+		assert(!cache.probe(hash, evaluation));
+		cache.store(hash, -123);
+		assert(cache.probe(hash, evaluation) && evaluation == -123);
+		assert(!cache.probe(hash ^ (1ull << 40), evaluation));
+	}
+	{
+		// Same position with the material only evaluator policy
+		ChessBoard board("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		MinMaxAiPlayer<MaterialEvaluator> minMaxPlayer(board.getNextPlayerColor(), false);
+		BoardMove move;
+		const MoveResult result = minMaxPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		assert(move == BoardMove(5, 2, 7, 3));
+		assert(MinMaxTree<MaterialEvaluator>().expand(ChessBoard(), 2) == 0);
+	}
+	{
+		// Both lines come from one search, the best one takes the queen and every line is playable
+		ChessBoard board("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+		MinMaxAiPlayer minMaxPlayer(board.getNextPlayerColor(), false);
+		minMaxPlayer.setMultiPV(2);
+		const std::vector<SearchLine>& lines = minMaxPlayer.analyze(board);
+		assert(lines.size() == 2);
+		assert(lines[0].moves[0] == BoardMove(5, 2, 7, 3));
+		assert(lines[0].evaluation >= lines[1].evaluation);
+		for (const SearchLine& line : lines) {
+			ChessBoard b(board);
+			for (const BoardMove move : line.moves) {
+				MovesVector moves;
+				b.getNextPlayerMoves(moves);
+				assert(std::find(moves.begin(), moves.end(), move) != moves.end());
+				b.playMove(move);
+			}
+		}
+	}
+
+	{
+		// Without the window dependent pruning MTD(f) finds the evaluation of a full window search of the same depth
+		const char* fens[] = {
+			"rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+			"r1bqk2r/pppp1ppp/2n2n2/2b1p3/2B1P3/3P1N2/PPP2PPP/RNBQK2R w KQkq - 1 5",
+			"r2q1rk1/pp2bppp/2np1n2/4p3/4P3/1NN1B3/PPP1BPPP/R2QK2R b KQ - 4 10",
+		};
+		SearchOptions options;
+		options.useNullMove = false;
+		options.useReverseFutility = false;
+		options.useRazoring = false;
+		options.useLateMoveReductions = false;
+		AspirationOptions fullWindow;
+		fullWindow.enabled = false;
+		for (const char* fen : fens) {
+			ChessBoard board(fen);
+			MinMaxAiPlayer alphaBetaPlayer(board.getNextPlayerColor(), false);
+			MinMaxAiPlayer mtdfPlayer(board.getNextPlayerColor(), false);
+			for (MinMaxAiPlayer<>* player : { &alphaBetaPlayer, &mtdfPlayer }) {
+				player->setSearchOptions(options);
+				player->setSearchDepth(5);
+			}
+			alphaBetaPlayer.setAspirationOptions(fullWindow);
+			mtdfPlayer.setRootSearch(RootSearch::MTDF);
+			const SearchLine alphaBetaLine = alphaBetaPlayer.analyze(board)[0];
+			const SearchLine mtdfLine = mtdfPlayer.analyze(board)[0];
+			assert(mtdfLine.evaluation == alphaBetaLine.evaluation);
+		}
+	}
+
+	{
+		// Rook mate, far past the depth of the search
+		ChessBoard board("8/8/8/8/8/3k4/8/3K3R w - - 0 1");
+		MateSolver solver(4);
+		const MateResult result = solver.solve(board, 0, DEFAULT_MATE_SOLVER_NODES);
+		assert(result.status == MateStatus::MATE);
+		assert(result.mateInMoves > 7);
+		assert(result.moves.size() == 2 * result.mateInMoves - 1);
+		for (const BoardMove move : result.moves) {
+			board.playMove(move);
+		}
+		MovesVector moves;
+		board.getNextPlayerMoves(moves);
+		assert(moves.empty() && board.isKingInCheck(board.getNextPlayerColor()));
+		assert(solver.solve(ChessBoard(), 2, DEFAULT_MATE_SOLVER_NODES).status == MateStatus::NO_MATE);
+	}
+
+	{
+		// Many moves mate, most of them not at once. With the mate solver on the player takes a mate in one
+		ChessBoard board("7k/8/6K1/8/8/8/8/QR6 w - - 0 1");
+		MinMaxAiPlayer minMaxPlayer(board.getNextPlayerColor(), false);
+		minMaxPlayer.setMateSolverNodes(DEFAULT_MATE_SOLVER_NODES);
+		BoardMove move;
+		const MoveResult result = minMaxPlayer.getMove(board, &move);
+		assert(result == MoveResult::MOVE_OK);
+		board.playMove(move);
+		MovesVector moves;
+		board.getNextPlayerMoves(moves);
+		assert(moves.empty() && board.isKingInCheck(board.getNextPlayerColor()));
+	}
+
 	// Check a position
 //	ChessBoard board("rnbqkbnr/1ppppppp/8/p7/2B1P3/5Q2/PPPP1PPP/RNB1K1NR b KQkq - 1 3");
 	ChessBoard board("r1bqk2r/1pp1bpp1/2n1p1n1/3p3p/p2PP2P/2PBBQ2/PP1N1PP1/2KR2NR w kq - 0 11");
 
-	MinMaxAiPlayer minMaxPlayer(board.getNextPlayerColor(), true, false, 1);
+	MinMaxAiPlayer minMaxPlayer(board.getNextPlayerColor(), true);
 
 	BoardMove move;
 	minMaxPlayer.getMove(board, &move);
@@ -37,7 +285,7 @@ int main() {
 	ChessBoard board;
 	BoardMove m;
 	for (uint32_t i = 0; i < TESTS; ++i) {
-		MinMaxAiPlayer pl(board.getNextPlayerColor(), false, false, 1);
+		MinMaxAiPlayer pl(board.getNextPlayerColor(), false);
 		MoveResult res = pl.getMove(board, &m);
 		if (res == MoveResult::MOVE_OK && !board.isDraw()) {
 			board.playMove(m);
@@ -59,7 +307,7 @@ int main() {
 	std::cout << "Starting game: " << '\n';
 	ChessBoard board;
 
-	MinMaxAiPlayer white(BLACK, true, true);
+	MinMaxAiPlayer white(BLACK, true);
 	HumanPlayer black(WHITE);
 	Game g(board, &black, &white, 0, true);
 
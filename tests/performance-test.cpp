@@ -1,8 +1,10 @@
 #include "neural-net-ai/nnai-player.h"
 #include "neural-net-ai/cai-population.h"
 #include "neural-net-ai/nnai-trainer.h"
+#include "neural-net-ai/packed-network.h"
 
 #include <chrono>
+#include <optional>
 
 const uint TESTS = 10;
 
@@ -13,6 +15,30 @@ int main() {
 	ChessBoard board("r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10");
 	nnpp::NeuronBuffer<float> neuronBuffer = nnpp::allocNeuronBuffer<float>();
 
+	// Only with an nnpp that can copy its weights
+	if (const std::optional<DenseNetwork> copy = toDenseNetwork(ai, ANALYZER_NETWORK_INDEX)) {
+		const uint feeds = 1000;
+		std::cout << "Feeding the analyzer " << feeds << " times with nnpp and with the packed network" << '\n';
+		const nnpp::NNPPStackVector<float> input = board.asFloats();
+		const PackedNetwork analyzer(*copy);
+		PackedBuffer packedBuffer;
+		float sum = 0.0f;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint i = 0; i < feeds; ++i) {
+			sum += ai.feedAt(ANALYZER_NETWORK_INDEX, input, neuronBuffer)[0];
+		}
+		std::chrono::duration<float> nnppDuration = std::chrono::high_resolution_clock::now() - start;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint i = 0; i < feeds; ++i) {
+			sum -= analyzer.feed(&input[0], packedBuffer);
+		}
+		std::chrono::duration<float> packedDuration = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "nnpp: " << nnppDuration.count() << " seconds, packed: " << packedDuration.count()
+			<< " seconds, difference: " << sum << '\n';
+	}
+
 	{
 		const uint sessions = 100;
 		const uint threads = 4;